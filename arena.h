@@ -0,0 +1,125 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <new>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace ML
+{
+//------------------------------------------------------------------------| Arena
+
+template <class T> class Arena
+/*------------------------------------------------------------------------------
+desc | . owns objects of one type, allocated in blocks and freed all at once.
+nots | . objects are never freed one by one, Clear destroys every one of them.
+     | . not thread safe, concurrent builders use an arena each and Splice them.
+     | . blocks grow geometrically from minBlock to maxBlock objects.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    static const size_t minBlock = 8;
+    static const size_t maxBlock = 1024;
+
+public :
+
+    Arena(void) : count(0) {}
+
+    Arena(Arena &&rhs) : count(0)
+    {
+        Splice(rhs);
+    }
+
+    ~Arena(void)
+    {
+        Clear();
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    Arena &operator=(Arena &&rhs)
+    {
+        if(this != &rhs)
+        {
+            Clear();
+            Splice(rhs);
+        }
+
+        return(*this);
+    }
+
+    size_t Size(void) const {return(count);}
+
+    template <class... A> T *New(A&&... args)
+    {
+        if(blocks.empty() || (blocks.back().used == blocks.back().size))
+        {
+            size_t size = blocks.empty() ? minBlock : 2 * blocks.back().size;
+
+            if(size > maxBlock) size = maxBlock;
+
+            blocks.push_back(Block(static_cast<T *>(::operator new(size * sizeof(T))), size));
+        }
+
+        Block &block = blocks.back();
+
+        T *object = new(block.objects + block.used) T(std::forward<A>(args)...);
+
+        ++block.used;
+        ++count;
+
+        return(object);
+    }
+
+    void Splice(Arena &rhs)
+    /*--------------------------------------------------------------------------
+    desc | . takes the objects of rhs, which is left empty.
+    --------------------------------------------------------------------------*/
+    {
+        blocks.insert(blocks.end(), rhs.blocks.begin(), rhs.blocks.end());
+        count += rhs.count;
+
+        rhs.blocks.clear();
+        rhs.count = 0;
+    }
+
+    void Clear(void)
+    {
+        for(Block &block : blocks)
+        {
+            for(size_t i = 0; i < block.used; ++i)
+                block.objects[i].~T();
+
+            ::operator delete(block.objects);
+        }
+
+        blocks.clear();
+        count = 0;
+    }
+
+private :
+
+    struct Block
+    {
+        T *objects;
+
+        size_t size;
+        size_t used;
+
+        Block(T *objects, size_t size) : objects(objects), size(size), used(0) {}
+    };
+
+    std::vector <Block> blocks;
+
+    size_t count;
+};
+}
+
+#endif // ARENA_H
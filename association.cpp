@@ -2,7 +2,10 @@
 auth | Roberto Peribáñez Iglesias (ergocortex) on Dec. 2018
 ------------------------------------------------------------------------------*/
 
+#include <set>
+#include <map>
 #include <limits.h>
+#include <algorithm>
 
 #include "association.h"
 
@@ -10,37 +13,198 @@ using namespace ML;
 
 //------------------------------------------------------------------------| ItemSet
 
-ItemSet::Item::Item(const MathOp mathop, const Variant &value, const std::vector <uint> &indexes) :
-    mathop(mathop), value(value), indexes(indexes) {}
+ItemSet::Item::Item(const uint column, const uint id, const MathOp mathop, const Variant &value,
+    const RowSet &indexes, const std::shared_ptr<const RowSet> &rows) : column(column), id(id), mathop(mathop),
+    value(value), indexes(indexes), rows(rows) {}
 
 ItemSet::ItemSet(const float &p) : p(p) {}
 
-std::vector <uint> &ItemSet::GetRestrictiveItem(const std::vector <uint> &restrictions)
+RowSet ItemSet::GetRestrictiveItem(const std::vector <uint> &restrictions) const
+/*------------------------------------------------------------------------------
+desc | . rows holding every restricted item.
+vars | restrictions : positions of the items taken into account, all if empty
+------------------------------------------------------------------------------*/
+{
+    std::vector <const RowSet *> rows = GetRows(restrictions);
+
+    if(rows.empty()) return(RowSet());
+
+    RowSet result(*rows[0]);
+
+    for(uint i = 1, n = rows.size(); i < n; ++i)
+        result = result.Intersection(*rows[i]);
+
+    return(result);
+}
+
+uint ItemSet::GetOverlapping(const std::vector <uint> &restrictions) const
+/*------------------------------------------------------------------------------
+nots | . the last intersection is only counted.
+------------------------------------------------------------------------------*/
 {
-    std::map<std::wstring, Item>::iterator restrictive = itemmap.end();
+    std::vector <const RowSet *> rows = GetRows(restrictions);
+
+    if(rows.empty()) return(0);
+
+    if(rows.size() == 1) return(rows[0]->Size());
 
-    uint size = std::numeric_limits<int>::max();
+    RowSet result(*rows[0]);
 
-    uint i = 0;
+    for(uint i = 1, n = rows.size(); i + 1 < n; ++i)
+        result = result.Intersection(*rows[i]);
 
-    for(auto it = itemmap.begin(); it != itemmap.end(); ++it, ++i)
+    return(result.IntersectionSize(*rows.back()));
+}
+
+std::vector <const RowSet *> ItemSet::GetRows(const std::vector <uint> &restrictions) const
+/*------------------------------------------------------------------------------
+desc | . row sets whose intersection holds the restricted items, smallest first.
+nots | . the longest prefix of restricted items is taken from its last item, the
+     |   rest of the items from their own rows.
+------------------------------------------------------------------------------*/
+{
+    uint n = items.size();
+
+    std::vector <bool> restricted(n, restrictions.empty());
+
+    for(uint i : restrictions)
     {
-        if(!restrictions.empty() && (std::find(restrictions.begin(), restrictions.end(), i) == restrictions.end()))
-            continue;
+        if(i < n) restricted[i] = true;
+    }
 
-        if(it->second.indexes.size() < size)
-        {
-            size = it->second.indexes.size();
-            restrictive = it;
-        }
+    std::vector <const RowSet *> rows;
+
+    uint prefix = 0;
+
+    while((prefix < n) && restricted[prefix])
+        ++prefix;
+
+    if(prefix) rows.push_back(&items[prefix - 1].indexes);
+
+    for(uint i = prefix; i < n; ++i)
+    {
+        if(restricted[i]) rows.push_back(items[i].rows.get());
     }
 
-    return(restrictive->second.indexes);
+    std::sort(rows.begin(), rows.end(), [](const RowSet *a, const RowSet *b) {return(a->Size() < b->Size());});
+
+    return(rows);
 }
 
-uint ItemSet::GetOverlapping(const std::vector <uint> &restrictions)
+//------------------------------------------------------------------------| FPTree
+
+struct FPTree
+/*------------------------------------------------------------------------------
+desc | . prefix tree of transactions, its nodes in a flat pool linked by position.
+vars | nodes : the root is the first one
+     | heads : last node added of every item, the others chained through next
+     | counts : support of every item in the tree
+nots | . paths go from the most to the least frequent items of the transactions.
+------------------------------------------------------------------------------*/
+{
+    struct Node
+    {
+        uint item;
+        uint count;
+
+        uint parent;
+        uint child;
+        uint sibling;
+        uint next;
+    };
+
+    std::vector <Node> nodes;
+
+    std::vector <uint> heads;
+    std::vector <uint> counts;
+
+    FPTree(uint items) : nodes(1, Node{(uint)-1, 0, (uint)-1, (uint)-1, (uint)-1, (uint)-1}), heads(items, -1),
+        counts(items, 0) {}
+
+    void Insert(const uint *path, uint size, uint count)
+    {
+        uint current = 0;
+
+        for(uint i = 0; i < size; ++i)
+        {
+            uint item = path[i];
+            uint child = nodes[current].child;
+
+            while((child != (uint)-1) && (nodes[child].item != item))
+                child = nodes[child].sibling;
+
+            if(child == (uint)-1)
+            {
+                child = nodes.size();
+
+                nodes.push_back(Node{item, 0, current, (uint)-1, nodes[current].child, heads[item]});
+
+                nodes[current].child = child;
+                heads[item] = child;
+            }
+
+            nodes[child].count += count;
+            counts[item] += count;
+
+            current = child;
+        }
+    }
+};
+
+static void Mine(const FPTree &tree, uint threshold, std::vector <uint> &suffix,
+    std::vector <std::vector <uint>> &frequent)
+/*------------------------------------------------------------------------------
+desc | . adds to frequent every itemset of the tree extended by suffix.
+nots | . the conditional tree of an item is built from the paths above its nodes,
+     |   keeping only the items frequent among them.
+------------------------------------------------------------------------------*/
 {
-    return(GetRestrictiveItem(restrictions).size());
+    uint items = tree.heads.size();
+
+    std::vector <uint> counts(items);
+    std::vector <uint> path;
+
+    for(uint item = 0; item < items; ++item)
+    {
+        if(tree.counts[item] < threshold) continue;
+
+        suffix.push_back(item);
+        frequent.push_back(suffix);
+
+        // '--> conditional pattern base
+
+        std::fill(counts.begin(), counts.end(), 0);
+
+        for(uint node = tree.heads[item]; node != (uint)-1; node = tree.nodes[node].next)
+        {
+            for(uint parent = tree.nodes[node].parent; parent != 0; parent = tree.nodes[parent].parent)
+                counts[tree.nodes[parent].item] += tree.nodes[node].count;
+        }
+
+        // '--> conditional tree
+
+        FPTree conditional(items);
+
+        for(uint node = tree.heads[item]; node != (uint)-1; node = tree.nodes[node].next)
+        {
+            path.clear();
+
+            for(uint parent = tree.nodes[node].parent; parent != 0; parent = tree.nodes[parent].parent)
+            {
+                if(counts[tree.nodes[parent].item] >= threshold)
+                    path.push_back(tree.nodes[parent].item);
+            }
+
+            std::reverse(path.begin(), path.end());
+
+            conditional.Insert(path.data(), path.size(), tree.nodes[node].count);
+        }
+
+        if(conditional.nodes.size() > 1)
+            Mine(conditional, threshold, suffix, frequent);
+
+        suffix.pop_back();
+    }
 }
 
 //------------------------------------------------------------------------| AssociationRules
@@ -60,163 +224,569 @@ float AssociationRules::Completeness::Calculate(void)
     return(result);
 }
 
-AssociationRules::AssociationRules(void) : support_threshold(3), confidence_threshold(0.9f) {}
+size_t AssociationRules::Hash::operator()(const std::vector <uint> &ids) const
+{
+    size_t hash = ids.size();
+
+    for(uint id : ids)
+        hash ^= id + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+
+    return(hash);
+}
+
+AssociationRules::AssociationRules(void) : support_threshold(3), confidence_threshold(0.9f),
+    mining(0), pool(nullptr) {}
 
-void AssociationRules::Generator(ItemSet *source)
+void AssociationRules::Generator(void)
 /*------------------------------------------------------------------------------
-nots | . high attributes entropy with low support threshold leads to out of memory
+desc | . level-wise (Apriori) search of the frequent itemsets.
+nots | . mining 1 hands the search to Growth.
+     | . every itemset is generated once, in canonical column order, from two
+     |   frequent itemsets one item shorter.
+     | . a level only needs the previous one, so memory is bounded by the
+     |   frequent itemsets and not by the orderings of their items.
 ------------------------------------------------------------------------------*/
 {
-    const int maxdeep = 0;
+    if(mining == 1)
+    {
+        Growth();
+        return;
+    }
 
-    static int deep = 0;
+    std::vector <ItemSet *> level;
 
-    ++deep;
+    GetItems(level);
 
-    for(uint i = 0, n = samples.attributes.size(); i < n; ++i)
+    while(!level.empty())
     {
-        if(source->itemmap.find(samples.attributes[i]->name) != source->itemmap.end()) continue;
+        for(ItemSet *set : level)
+            Store(set);
 
-        std::vector<ML::Attribute::ProbabilityDistribution> *probabilityDistribution = nullptr;
+        std::vector <ItemSet *> previous;
 
-        // '--> if itemmap is empty calculate distribution of all elements.
+        previous.swap(level);
 
-        if(source->itemmap.empty())
-            probabilityDistribution = samples.attributes[i]->GetProbabilityDistribution();
-        else
-            probabilityDistribution = samples.attributes[i]->GetProbabilityDistribution(source->GetRestrictiveItem());
+        Extend(previous, level);
+    }
+}
+
+void AssociationRules::GetItems(std::vector <ItemSet *> &level)
+/*------------------------------------------------------------------------------
+desc | . frequent itemsets of one item, in column order.
+nots | . null values and empty buckets are not items.
+     | . support is counted on the rows of the item, the p of a density
+     |   function comes from the median position and may differ on ties.
+------------------------------------------------------------------------------*/
+{
+    uint id = 0;
+    uint threshold = (uint)(std::max(support_threshold, 1));
+
+    float N = samples.Size();
+
+    for(uint i = 0, n = samples.attributes.size(); i < n; ++i)
+    {
+        std::vector<ML::Attribute::ProbabilityDistribution> *probabilityDistribution =
+            samples.attributes[i]->GetProbabilityDistribution();
 
-        for(auto it = probabilityDistribution->end(); it != probabilityDistribution->begin();  --it)
+        for(auto &distribution : *probabilityDistribution)
         {
-            auto &distribution = *(it - 1);
+            if(distribution.value.IsNull() || (distribution.indexes.Size() < threshold)) continue;
+
+            std::shared_ptr<RowSet> rows = std::make_shared<RowSet>(distribution.indexes);
+
+            rows->Compact();
+
+            level.push_back(new ItemSet((float)(rows->Size())/N));
 
-            if(distribution.value.IsNull() || (distribution.indexes.size() < support_threshold))
-                probabilityDistribution->erase(it - 1);
+            level.back()->items.push_back(ItemSet::Item(i, id++, distribution.mathop, distribution.value, *rows,
+                rows));
         }
 
-        if(probabilityDistribution->empty()) continue;
+        delete(probabilityDistribution);
+    }
+}
 
-        for(auto &distribution : *probabilityDistribution)
+void AssociationRules::Extend(const std::vector <ItemSet *> &previous, std::vector <ItemSet *> &level)
+/*------------------------------------------------------------------------------
+desc | . frequent itemsets of k items from the frequent itemsets of k - 1.
+nots | . previous is sorted by item ids, so itemsets sharing the first k - 2 items
+     |   are contiguous and their join keeps the order.
+     | . a candidate is dropped if any subset of k - 1 items is not frequent
+     |   (downward closure), before its rows are counted.
+     | . candidates of the level are counted in one batch, without building
+     |   their rows, which are only kept for the frequent ones.
+     | . a candidate PXY is counted on the rows of PX and PY, or on deep levels
+     |   of dense data, where itemsets lose fewer rows than they keep, on their
+     |   diffsets d(PX) = t(P) - t(PX) : supp(PXY) = supp(PX) - |d(PY) - d(PX)|.
+------------------------------------------------------------------------------*/
+{
+    std::set <std::vector <uint>> frequent;
+
+    for(ItemSet *source : previous)
+    {
+        std::vector <uint> ids;
+
+        for(const ItemSet::Item &item : source->items)
+            ids.push_back(item.id);
+
+        frequent.insert(ids);
+    }
+
+    // '--> join and prune
+
+    std::vector <std::pair <uint, uint>> candidates;
+
+    for(uint a = 0, n = previous.size(); a < n; ++a)
+    {
+        const std::vector <ItemSet::Item> &prefix = previous[a]->items;
+
+        uint k = prefix.size();
+
+        for(uint b = a + 1; b < n; ++b)
         {
-            itemSet.push_back(new ItemSet(*source));
+            const std::vector <ItemSet::Item> &items = previous[b]->items;
+
+            bool shared = true;
+
+            for(uint i = 0; shared && (i + 1 < k); ++i)
+                shared = (prefix[i].id == items[i].id);
+
+            if(!shared) break;
+
+            if(prefix[k - 1].column == items[k - 1].column) continue;
 
-            itemSet.back()->p = distribution.p;
+            std::vector <uint> ids;
 
-            itemSet.back()->itemmap.insert(std::pair<std::wstring, ItemSet::Item>(samples.attributes[i]->name,
-                ItemSet::Item(distribution.mathop, distribution.value, distribution.indexes)));
+            for(const ItemSet::Item &item : prefix)
+                ids.push_back(item.id);
 
-            if((maxdeep == 0) || (deep < maxdeep))
+            ids.push_back(items[k - 1].id);
+
+            bool closed = true;
+
+            for(uint skip = 0; closed && (skip + 2 < ids.size()); ++skip)
             {
-                Generator(itemSet.back());
+                std::vector <uint> subset(ids);
+
+                subset.erase(subset.begin() + skip);
+
+                closed = (frequent.find(subset) != frequent.end());
             }
+
+            if(closed) candidates.push_back(std::pair <uint, uint>(a, b));
         }
+    }
 
-        delete(probabilityDistribution);
+    // '--> count
+
+    float N = samples.Size();
+
+    uint threshold = (uint)(std::max(support_threshold, 1));
+
+    uint k = previous.empty() ? 0 : previous[0]->items.size();
+
+    uint64_t kept = 0;
+    uint64_t lost = 0;
+
+    for(uint i = 0, n = (k >= 2) ? previous.size() : 0; i < n; ++i)
+    {
+        kept += previous[i]->items[k - 1].indexes.Size();
+        lost += previous[i]->items[k - 2].indexes.Size() - previous[i]->items[k - 1].indexes.Size();
     }
 
-    --deep;
+    bool diffsets = (k >= 2) && (lost < kept);
+
+    std::vector <RowSet> differences;
+
+    for(uint i = 0, n = diffsets ? previous.size() : 0; i < n; ++i)
+        differences.push_back(previous[i]->items[k - 2].indexes.Difference(previous[i]->items[k - 1].indexes));
+
+    for(const std::pair <uint, uint> &candidate : candidates)
+    {
+        const RowSet &lhs = previous[candidate.first]->items.back().indexes;
+        const RowSet &rhs = previous[candidate.second]->items.back().indexes;
+
+        uint support = diffsets ?
+            (lhs.Size() - differences[candidate.second].DifferenceSize(differences[candidate.first])) :
+            lhs.IntersectionSize(rhs);
+
+        if(support < threshold) continue;
+
+        RowSet rows = diffsets ? lhs.Difference(differences[candidate.second]) : lhs.Intersection(rhs);
+
+        const ItemSet::Item &last = previous[candidate.second]->items.back();
+
+        level.push_back(new ItemSet((float)(rows.Size())/N));
+
+        level.back()->items = previous[candidate.first]->items;
+        level.back()->items.push_back(ItemSet::Item(last.column, last.id, last.mathop, last.value, rows, last.rows));
+    }
 }
 
-float AssociationRules::CalcConfidence(ItemSet *itemSet, uint mask)
+void AssociationRules::Growth(void)
+/*------------------------------------------------------------------------------
+desc | . FP-Growth search of the frequent itemsets.
+nots | . the transaction of a row holds the frequent items it falls in, sorted by
+     |   decreasing support so that rows share the prefixes of the tree.
+     | . the rows of an itemset are only computed once it is known frequent, from
+     |   those of its prefix and its last item, and only for the items downstream.
+     | . itemsets are sorted by size and then by ids, the order of Generator.
+------------------------------------------------------------------------------*/
 {
-    std::vector <uint> restrictions;
+    std::vector <ItemSet *> singles;
+
+    GetItems(singles);
+
+    uint items = singles.size();
+    uint threshold = (uint)(std::max(support_threshold, 1));
+
+    // '--> transactions
+
+    uint universe = 0;
 
-    // '--> antecedents (ones)
+    for(ItemSet *single : singles)
+        universe = std::max(universe, single->items[0].indexes.Universe());
 
-    restrictions.clear();
+    std::vector <uint> order(items);
 
-    for(uint i = 0, n = itemSet->itemmap.size(); i < n; ++i)
+    for(uint i = 0; i < items; ++i)
+        order[i] = i;
+
+    std::stable_sort(order.begin(), order.end(), [&singles](uint a, uint b)
+        {return(singles[a]->items[0].indexes.Size() > singles[b]->items[0].indexes.Size());});
+
+    std::vector <uint> offsets(universe + 1, 0);
+
+    for(ItemSet *single : singles)
     {
-        if(mask & (1 << i))
-            restrictions.push_back(i);
+        for(uint row : single->items[0].indexes)
+            ++offsets[row + 1];
     }
 
-    float antecedends = itemSet->GetOverlapping(restrictions);
+    for(uint row = 0; row < universe; ++row)
+        offsets[row + 1] += offsets[row];
 
-    // '--> consequents (zeros)
+    std::vector <uint> transactions(offsets[universe]);
+    std::vector <uint> filled(offsets.begin(), offsets.end() - 1);
 
-    restrictions.clear();
+    for(uint item : order)
+    {
+        for(uint row : singles[item]->items[0].indexes)
+            transactions[filled[row]++] = item;
+    }
+
+    // '--> tree
+
+    FPTree tree(items);
 
-    for(uint i = 0, n = itemSet->itemmap.size(); i < n; ++i)
+    for(uint row = 0; row < universe; ++row)
     {
-        if(!(mask & (1 << i)))
-            restrictions.push_back(i);
+        if(offsets[row + 1] > offsets[row])
+            tree.Insert(&transactions[offsets[row]], offsets[row + 1] - offsets[row], 1);
+    }
+
+    // '--> mining
+
+    std::vector <std::vector <uint>> frequent;
+    std::vector <uint> suffix;
+
+    Mine(tree, threshold, suffix, frequent);
+
+    for(std::vector <uint> &ids : frequent)
+        std::sort(ids.begin(), ids.end());
+
+    std::sort(frequent.begin(), frequent.end(), [](const std::vector <uint> &a, const std::vector <uint> &b)
+        {return((a.size() < b.size()) || ((a.size() == b.size()) && (a < b)));});
+
+    // '--> itemsets
+
+    float N = samples.Size();
+
+    std::map <std::vector <uint>, ItemSet *> prefixes;
+
+    for(const std::vector <uint> &ids : frequent)
+    {
+        ItemSet *single = singles[ids.back()];
+
+        if(ids.size() == 1)
+            Store(single);
+        else
+        {
+            ItemSet *prefix = prefixes[std::vector <uint>(ids.begin(), ids.end() - 1)];
+
+            const ItemSet::Item &last = single->items[0];
+
+            RowSet rows = prefix->items.back().indexes.Intersection(last.indexes);
+
+            ItemSet *set = new ItemSet((float)(rows.Size())/N);
+
+            set->items = prefix->items;
+            set->items.push_back(ItemSet::Item(last.column, last.id, last.mathop, last.value, rows, last.rows));
+
+            Store(set);
+        }
+
+        prefixes[ids] = itemSet.back();
     }
+}
+
+void AssociationRules::Store(ItemSet *set)
+/*------------------------------------------------------------------------------
+desc | . adds a frequent itemset and its support to the store.
+------------------------------------------------------------------------------*/
+{
+    std::vector <uint> ids;
 
-    float consequents = itemSet->GetOverlapping(restrictions);
+    for(const ItemSet::Item &item : set->items)
+        ids.push_back(item.id);
 
-    return(min(consequents / antecedends, 1.0f));
+    supports[ids] = set->items.back().indexes.Size();
+
+    itemSet.push_back(set);
+}
+
+float AssociationRules::CalcConfidence(ItemSet *itemSet, uint mask)
+/*------------------------------------------------------------------------------
+desc | . confidence of the rule whose antecedents X are the ones of mask and its
+     |   consequents Y the zeros, supp(X u Y) / supp(X).
+nots | . mask holds the first 32 items, any later one is a consequent.
+------------------------------------------------------------------------------*/
+{
+    std::vector <uint> antecedents;
+
+    for(uint i = 0, n = std::min((uint)(itemSet->items.size()), 32u); i < n; ++i)
+    {
+        if(mask & (1u << i))
+            antecedents.push_back(i);
+    }
+
+    return(GetConfidence(itemSet, antecedents));
 }
 
 void AssociationRules::CreateRule(ItemSet *itemSet, uint mask, float p)
 {
-    std::map<std::wstring, ItemSet::Item>::iterator it;
+    std::vector <bool> consequents(itemSet->items.size(), true);
 
-    rules.push_back(new Rule());
+    for(uint i = 0, n = std::min((uint)(itemSet->items.size()), 32u); i < n; ++i)
+        consequents[i] = !(mask & (1u << i));
 
-    // '--> antecedents (ones)
+    rules.push_back(GetRule(itemSet, consequents, p));
+}
+
+float AssociationRules::GetConfidence(ItemSet *set, const std::vector <uint> &antecedents)
+/*------------------------------------------------------------------------------
+desc | . confidence of the rule whose antecedents X are the items at the given
+     |   ascending positions and its consequents Y the rest.
+nots | . X is a subset of a frequent itemset, so the store holds its support. An
+     |   itemset mined elsewhere is counted on its rows.
+------------------------------------------------------------------------------*/
+{
+    std::vector <uint> ids;
+
+    for(uint i : antecedents)
+        ids.push_back(set->items[i].id);
+
+    std::unordered_map <std::vector <uint>, uint, Hash>::const_iterator it = supports.find(ids);
+
+    float support = (it != supports.end()) ? it->second : set->GetOverlapping(antecedents);
+    float all = set->items.back().indexes.Size();
+
+    return(support ? (all / support) : 0.0f);
+}
+
+Rule *AssociationRules::GetRule(ItemSet *set, const std::vector <bool> &consequents, float p)
+{
+    Rule *rule = new Rule();
 
-    it = itemSet->itemmap.begin();
+    // '--> antecedents
 
-    for(uint i = 0, n = itemSet->itemmap.size(); i < n; ++i, ++it)
+    for(uint i = 0, n = set->items.size(); i < n; ++i)
     {
-        if(mask & (1 << i))
-            rules.back()->antecedents.push_back(Rule::Factor(it->first, it->second.mathop, it->second.value));
+        const ItemSet::Item &item = set->items[i];
+
+        if(!consequents[i])
+            rule->antecedents.push_back(Rule::Factor(samples.attributes[item.column]->name, item.mathop,
+                item.value, item.column));
     }
 
-    // '--> consequents (zeros)
+    // '--> consequents
+
+    for(uint i = 0, n = set->items.size(); i < n; ++i)
+    {
+        const ItemSet::Item &item = set->items[i];
+
+        if(consequents[i])
+            rule->consequents.push_back(Rule::Factor(samples.attributes[item.column]->name, item.mathop,
+                item.value, item.column));
+    }
+
+    rule->p = p;
+
+    return(rule);
+}
+
+void AssociationRules::GetRules(ItemSet *set, std::vector <Rule *> &buffer)
+/*------------------------------------------------------------------------------
+desc | . rules of an itemset, in mask order, added to buffer.
+vars | level : ascending positions of the consequents that passed, of m items,
+     |   in lexicographic order
+     | passed : consequents flagged by position of every rule that passed
+nots | . consequents grow one item at a time (ap-genrules) : those of m + 1 items
+     |   join two of m items sharing the first m - 1, and are scored only if all
+     |   their subsets of m items passed, as moving an item to the consequents can
+     |   only lower confidence. Work follows the rules that pass, not the 2^n
+     |   masks, so itemsets of any size are handled.
+     | . mask order reads the antecedents as a binary number whose first item is
+     |   the lowest bit, as CalcConfidence does.
+------------------------------------------------------------------------------*/
+{
+    struct Candidate
+    {
+        std::vector <bool> consequents;
+
+        float p;
+    };
 
-    it = itemSet->itemmap.begin();
+    uint n = set->items.size();
 
-    for(uint i = 0, n = itemSet->itemmap.size(); i < n; ++i, ++it)
+    if(n < 2) return;
+
+    std::vector <std::vector <uint>> level;
+    std::vector <Candidate> passed;
+
+    auto score = [this, set, n, &passed](const std::vector <uint> &consequents)
     {
-        if(!(mask & (1 << i)))
-            rules.back()->consequents.push_back(Rule::Factor(it->first, it->second.mathop, it->second.value));
+        Candidate candidate;
+
+        candidate.consequents.assign(n, false);
+
+        for(uint i : consequents)
+            candidate.consequents[i] = true;
+
+        std::vector <uint> antecedents;
+
+        for(uint i = 0; i < n; ++i)
+        {
+            if(!candidate.consequents[i])
+                antecedents.push_back(i);
+        }
+
+        candidate.p = GetConfidence(set, antecedents);
+
+        if(!(candidate.p > confidence_threshold)) return(false);
+
+        passed.push_back(candidate);
+
+        return(true);
+    };
+
+    // '--> consequents of one item
+
+    for(uint i = 0; i < n; ++i)
+    {
+        std::vector <uint> consequents(1, i);
+
+        if(score(consequents))
+            level.push_back(consequents);
     }
 
-    rules.back()->p = p;
+    // '--> consequents of m + 1 items, while the antecedents keep one
+
+    for(uint m = 1; (m + 1 < n) && (level.size() > 1); ++m)
+    {
+        std::vector <std::vector <uint>> next;
+
+        for(uint i = 0, size = level.size(); i < size; ++i)
+        {
+            for(uint j = i + 1; (j < size) && std::equal(level[i].begin(), level[i].end() - 1, level[j].begin()); ++j)
+            {
+                std::vector <uint> consequents(level[i]);
+
+                consequents.push_back(level[j].back());
+
+                // '--> the subsets without one of the last two items are i and j
+
+                bool candidate = true;
+
+                for(uint k = 0; candidate && (k + 2 < consequents.size()); ++k)
+                {
+                    std::vector <uint> subset(consequents);
+
+                    subset.erase(subset.begin() + k);
+
+                    candidate = std::binary_search(level.begin(), level.end(), subset);
+                }
+
+                if(candidate && score(consequents))
+                    next.push_back(consequents);
+            }
+        }
+
+        level.swap(next);
+    }
+
+    // '--> mask order
+
+    std::sort(passed.begin(), passed.end(), [n](const Candidate &a, const Candidate &b)
+    {
+        for(uint i = n; i-- > 0;)
+        {
+            if(a.consequents[i] != b.consequents[i])
+                return(bool(a.consequents[i]));
+        }
+
+        return(false);
+    });
+
+    for(const Candidate &candidate : passed)
+        buffer.push_back(GetRule(set, candidate.consequents, candidate.p));
 }
 
 void AssociationRules::Build(void)
 /*------------------------------------------------------------------------------
 nots | . confidence is the probability of the rule.
+     | . every candidate is a lookup in the supports stored while mining, so
+     |   rules cost time linear in their candidates.
+     | . itemsets are split in blocks with a buffer each, merged in block order,
+     |   so rules come in the same order with or without pool.
 ------------------------------------------------------------------------------*/
 {
     itemSet.clear();
     rules.clear();
+    supports.clear();
 
     // '--> ItemSet Generation
 
-    itemSet.push_back(new ItemSet());
-
-    Generator(itemSet.back());
+    Generator();
 
     // '--> Rule Generation
 
-    for(uint i = 0, n = itemSet.size(); i < n; ++i)
-    {
-        // '--> combinations of bits with neither all zeroes nor all ones.
+    uint n = itemSet.size();
+    uint blocks = pool ? std::min(n, 8 * pool->Size()) : std::min(n, 1u);
 
-        int bits = itemSet[i]->itemmap.size();
+    std::vector <std::vector <Rule *>> buffers(blocks);
 
-        uint combinations = max(0, pow(2, bits) - 2);
-
-        for(uint mask = 1; mask <= combinations; ++mask)
-        {
-            float confidence = CalcConfidence(itemSet[i], mask);
+    ParallelFor(pool, blocks, [this, n, blocks, &buffers](uint block)
+    {
+        for(uint i = block * n / blocks, last = (block + 1) * n / blocks; i < last; ++i)
+            GetRules(itemSet[i], buffers[block]);
+    });
 
-            if(confidence > confidence_threshold)
-                CreateRule(itemSet[i], mask, confidence);
-        }
-    }
+    for(const std::vector <Rule *> &buffer : buffers)
+        rules.insert(rules.end(), buffer.begin(), buffer.end());
 }
 
 AssociationRules::Completeness *AssociationRules::Predict(DataFrame &sample)
+/*------------------------------------------------------------------------------
+vars | columns : column of sample for every trained column, resolved once per call
+------------------------------------------------------------------------------*/
 {
     if(rules.empty()) return(nullptr);
 
     std::vector <Completeness> completeness;
 
+    std::vector <uint> columns(samples.attributes.size(), -1);
+
     // '--> Populate
 
     for(uint i = 0, n = rules.size(); i < n; ++i)
@@ -225,8 +795,19 @@ AssociationRules::Completeness *AssociationRules::Predict(DataFrame &sample)
 
         for(uint j = 0, m = rules[i]->antecedents.size(); j < m; ++j)
         {
-            std::wstring attribute = rules[i]->antecedents[j].attribute;
-            uint index = sample.GetColumnByAttribute(attribute);
+            const Rule::Factor &factor = rules[i]->antecedents[j];
+
+            uint index;
+
+            if(factor.column < columns.size())
+            {
+                if(columns[factor.column] == (uint)-1)
+                    columns[factor.column] = sample.GetColumnByAttribute(factor.attribute, factor.column);
+
+                index = columns[factor.column];
+            }
+            else
+                index = sample.GetColumnByAttribute(factor.attribute);
 
             Variant valueA = sample.attributes[index]->GetCell(0);
             Variant valueB = rules[i]->antecedents[j].value;
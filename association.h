@@ -7,32 +7,54 @@ auth | Roberto Peribáñez Iglesias (ergocortex) 2018
 
 #include "core.h"
 #include "rule.h"
+#include "pool.h"
 
 namespace ML
 {
 //------------------------------------------------------------------------| ItemSet
 
 class ItemSet
+/*------------------------------------------------------------------------------
+desc | . frequent set of items, at most one by column.
+vars | items : in column order, which is the order of their ids
+     | p : support, as a fraction of the samples
+nots | . the last item holds the rows of the whole set and every other one the
+     |   rows of the prefix it closes.
+     | . rows of a subset are exact, the intersection of its longest prefix with
+     |   the rows of its other items.
+------------------------------------------------------------------------------*/
 {
 public :
 
     struct Item
+    /*--------------------------------------------------------------------------
+    vars | column : id of the attribute in samples
+         | id : id of the frequent item, numbered in column order
+         | indexes : rows of the prefix closed by the item
+         | rows : rows of the item alone, shared by every set holding it
+    --------------------------------------------------------------------------*/
     {
     public :
 
+        uint column;
+        uint id;
+
         MathOp mathop;
         Variant value;
 
-        std::vector <uint> indexes;
+        RowSet indexes;
+
+        std::shared_ptr<const RowSet> rows;
 
     public :
 
-        Item(const MathOp mathop, const Variant &value, const std::vector <uint> &indexes);
+        Item(const uint column, const uint id, const MathOp mathop, const Variant &value, const RowSet &indexes,
+            const std::shared_ptr<const RowSet> &rows);
     };
 
 public :
 
-    std::map <std::wstring, Item> itemmap;
+    std::vector <Item> items;
 
     float p;
 
@@ -40,13 +62,25 @@ public :
 
     ItemSet(const float &p = 0.0f);
 
-    std::vector<uint> &GetRestrictiveItem(const std::vector<uint> &restrictions = {});
-    uint GetOverlapping(const std::vector <uint> &restrinction);
+    RowSet GetRestrictiveItem(const std::vector<uint> &restrictions = {}) const;
+    uint GetOverlapping(const std::vector <uint> &restrinction) const;
+
+private :
+
+    std::vector <const RowSet *> GetRows(const std::vector <uint> &restrictions) const;
 };
 
 //------------------------------------------------------------------------| AssociationRules
 
 class AssociationRules
+/*------------------------------------------------------------------------------
+vars | support_threshold : minimum rows of a frequent itemset, 1 when lower
+     | supports : rows of every frequent itemset, keyed by its sorted item ids
+     | mining | 0 : Apriori, level-wise candidates counted on the rows of the items
+            | 1 : FP-Growth, recursive mining of a prefix tree of the transactions
+     | pool : optional, used to generate the rules of the itemsets concurrently
+nots | . both give the same frequent itemsets, in the same order.
+------------------------------------------------------------------------------*/
 {
 public :
 
@@ -67,6 +101,11 @@ public :
         float Calculate(void);
     };
 
+    struct Hash
+    {
+        size_t operator()(const std::vector <uint> &ids) const;
+    };
+
 public :
 
     DataFrame samples;
@@ -74,20 +113,40 @@ public :
     std::vector <ItemSet *> itemSet;
     std::vector <Rule *> rules;
 
+    std::unordered_map <std::vector <uint>, uint, Hash> supports;
+
     int   support_threshold;
     float confidence_threshold;
 
+    ubyte mining;
+
+    ThreadPool *pool;
+
 public :
 
     AssociationRules(void);
 
-    void Generator(ItemSet *source);
+    void Generator(void);
     float CalcConfidence(ItemSet *itemSet, uint mask);
     void CreateRule(ItemSet *itemSet, uint mask, float p);
 
     void Build(void);
 
     Completeness *Predict(DataFrame &sample);
+
+private :
+
+    void GetItems(std::vector <ItemSet *> &level);
+    void Extend(const std::vector <ItemSet *> &previous, std::vector <ItemSet *> &level);
+
+    void Growth(void);
+
+    void Store(ItemSet *set);
+
+    float GetConfidence(ItemSet *set, const std::vector <uint> &antecedents);
+
+    void GetRules(ItemSet *set, std::vector <Rule *> &buffer);
+    Rule *GetRule(ItemSet *set, const std::vector <bool> &consequents, float p);
 };
 }
 
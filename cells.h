@@ -0,0 +1,311 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#ifndef CELLS_H
+#define CELLS_H
+
+#include <memory>
+#include <cstring>
+#include <cstddef>
+#include <iterator>
+#include <algorithm>
+#include <type_traits>
+#include <stdint.h>
+
+namespace ML
+{
+//------------------------------------------------------------------------| Cells
+
+template <class T> class Cells
+/*------------------------------------------------------------------------------
+desc | . contiguous cells of a column, either owned or borrowed from storage
+     |   that outlives them, such as the pages of a mapped file.
+nots | . cells are read only through operator[], writes go through Set and
+     |   push_back, which copy borrowed cells into owned memory first.
+     | . holder keeps the borrowed storage alive.
+     | . version grows with every change of the cells, never going back.
+------------------------------------------------------------------------------*/
+{
+    static_assert(std::is_trivially_copyable<T>::value, "cells must be trivially copyable");
+
+public :
+
+    Cells(void) : buffer(nullptr), count(0), allocated(0), version(0) {}
+
+    Cells(const Cells &rhs) : buffer(nullptr), count(0), allocated(0), version(0)
+    {
+        assign(rhs.begin(), rhs.end());
+    }
+
+    Cells(Cells &&rhs) : buffer(nullptr), count(0), allocated(0), version(0)
+    {
+        swap(rhs);
+    }
+
+    ~Cells(void)
+    {
+        Release();
+    }
+
+    Cells &operator=(const Cells &rhs)
+    {
+        if(this != &rhs) assign(rhs.begin(), rhs.end());
+
+        return(*this);
+    }
+
+    Cells &operator=(Cells &&rhs)
+    {
+        swap(rhs);
+
+        return(*this);
+    }
+
+    size_t size(void) const {return(count);}
+    size_t capacity(void) const {return(allocated);}
+    bool empty(void) const {return(count == 0);}
+
+    const T *data(void) const {return(buffer);}
+
+    const T &operator[](size_t index) const {return(buffer[index]);}
+
+    const T &back(void) const {return(buffer[count - 1]);}
+
+    const T *begin(void) const {return(buffer);}
+    const T *end(void) const {return(buffer + count);}
+
+    bool IsBorrowed(void) const {return(holder != nullptr);}
+
+    uint64_t Version(void) const {return(version);}
+
+    void Set(size_t index, const T &value)
+    {
+        Own();
+
+        buffer[index] = value;
+        ++version;
+    }
+
+    void push_back(const T &value)
+    {
+        if(count == allocated || holder) reserve((count < 8) ? 16 : 2 * count);
+
+        buffer[count++] = value;
+        ++version;
+    }
+
+    void reserve(size_t size)
+    {
+        if(!holder && (size <= allocated)) return;
+
+        size = std::max(size, count);
+
+        T *owned = new T[size];
+
+        if(count) memcpy(owned, buffer, count * sizeof(T));
+
+        Release();
+
+        buffer = owned;
+        allocated = size;
+    }
+
+    void clear(void)
+    {
+        if(holder) Release();
+
+        count = 0;
+        ++version;
+    }
+
+    template <class I> void assign(I first, I last)
+    {
+        clear();
+
+        reserve(std::distance(first, last));
+
+        for(; first != last; ++first)
+            buffer[count++] = *first;
+    }
+
+    void Borrow(const T *cells, size_t size, const std::shared_ptr<const void> &storage)
+    {
+        Release();
+
+        buffer = const_cast<T *>(cells);
+        count = size;
+        allocated = size;
+        holder = storage;
+
+        ++version;
+    }
+
+    void swap(Cells &rhs)
+    {
+        std::swap(buffer, rhs.buffer);
+        std::swap(count, rhs.count);
+        std::swap(allocated, rhs.allocated);
+
+        holder.swap(rhs.holder);
+
+        ++version;
+        ++rhs.version;
+    }
+
+private :
+
+    T *buffer;
+
+    size_t count;
+    size_t allocated;
+
+    uint64_t version;
+
+    std::shared_ptr<const void> holder;
+
+private :
+
+    void Own(void)
+    {
+        if(holder) reserve(count);
+    }
+
+    void Release(void)
+    {
+        if(!holder) delete[](buffer);
+
+        holder.reset();
+
+        buffer = nullptr;
+        allocated = 0;
+    }
+};
+
+//------------------------------------------------------------------------| BitCells
+
+class BitCells
+/*------------------------------------------------------------------------------
+desc | . cells of a bool column packed 64 to a word, owned or borrowed as Cells.
+nots | . cell i is bit (i & 63) of word (i >> 6).
+     | . bits past the last cell are always zero, so words can be counted whole.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    BitCells(void) : count(0), version(0) {}
+
+    BitCells(const BitCells &rhs) : words(rhs.words), count(rhs.count), version(0) {}
+
+    BitCells(BitCells &&rhs) : count(0), version(0)
+    {
+        swap(rhs);
+    }
+
+    BitCells &operator=(const BitCells &rhs)
+    {
+        if(this == &rhs) return(*this);
+
+        words = rhs.words;
+        count = rhs.count;
+        ++version;
+
+        return(*this);
+    }
+
+    BitCells &operator=(BitCells &&rhs)
+    {
+        swap(rhs);
+
+        return(*this);
+    }
+
+    size_t size(void) const {return(count);}
+    size_t capacity(void) const {return(words.capacity() << 6);}
+    bool empty(void) const {return(count == 0);}
+
+    bool operator[](size_t index) const {return((words[index >> 6] >> (index & 63)) & 1);}
+
+    bool back(void) const {return((*this)[count - 1]);}
+
+    const uint64_t *Words(void) const {return(words.data());}
+    size_t WordCount(void) const {return((count + 63) >> 6);}
+
+    bool IsBorrowed(void) const {return(words.IsBorrowed());}
+
+    uint64_t Version(void) const {return(version);}
+
+    void Set(size_t index, bool value)
+    {
+        uint64_t bit = uint64_t(1) << (index & 63);
+        uint64_t word = words[index >> 6];
+
+        words.Set(index >> 6, value ? (word | bit) : (word & ~bit));
+        ++version;
+    }
+
+    void push_back(bool value)
+    {
+        if(!(count & 63)) words.push_back(0);
+
+        ++count;
+        ++version;
+
+        if(value) Set(count - 1, true);
+    }
+
+    void reserve(size_t size)
+    {
+        words.reserve((size + 63) >> 6);
+    }
+
+    void clear(void)
+    {
+        words.clear();
+
+        count = 0;
+        ++version;
+    }
+
+    template <class I> void assign(I first, I last)
+    {
+        clear();
+
+        reserve(std::distance(first, last));
+
+        for(; first != last; ++first)
+            push_back(*first);
+    }
+
+    void Borrow(const uint64_t *bits, size_t size, const std::shared_ptr<const void> &storage)
+    /*--------------------------------------------------------------------------
+    nots | . bits past size in the last word must be zero.
+    --------------------------------------------------------------------------*/
+    {
+        words.Borrow(bits, (size + 63) >> 6, storage);
+
+        count = size;
+        ++version;
+    }
+
+    void swap(BitCells &rhs)
+    {
+        words.swap(rhs.words);
+
+        std::swap(count, rhs.count);
+
+        ++version;
+        ++rhs.version;
+    }
+
+private :
+
+    Cells <uint64_t> words;
+
+    size_t count;
+
+    uint64_t version;
+};
+}
+
+#endif // CELLS_H
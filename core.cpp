@@ -3,6 +3,7 @@ auth | Roberto Peribáñez Iglesias (ergocortex) 2018
 ------------------------------------------------------------------------------*/
 
 #include <map>
+#include <cstdio>
 
 #include "core.h"
 
@@ -29,14 +30,85 @@ Variant::Variant(float f) : type(Float)
 
 Variant::Variant(const std::wstring &wstring) : type(WString)
 {
-    std::wstring *string = new std::wstring(wstring);
+    data.text = new Text(wstring);
+}
+
+Variant::Variant(const Variant &rhs) : type(rhs.type), data(rhs.data)
+{
+    if(type == WString) data.text->references.fetch_add(1, std::memory_order_relaxed);
+}
+
+Variant::Variant(Variant &&rhs) : type(rhs.type), data(rhs.data)
+/*------------------------------------------------------------------------------
+nots | . rhs is left Generic.
+------------------------------------------------------------------------------*/
+{
+    rhs.type = Generic;
+}
+
+Variant::~Variant(void)
+{
+    Release();
+}
+
+Variant &Variant::operator=(const Variant &rhs)
+/*------------------------------------------------------------------------------
+nots | . rhs is taken before releasing, it may be this variant.
+------------------------------------------------------------------------------*/
+{
+    Type rhsType = rhs.type;
+    Data rhsData = rhs.data;
+
+    if(rhsType == WString) rhsData.text->references.fetch_add(1, std::memory_order_relaxed);
+
+    Release();
+
+    type = rhsType;
+    data = rhsData;
+
+    return(*this);
+}
+
+Variant &Variant::operator=(Variant &&rhs)
+{
+    if(this != &rhs)
+    {
+        Release();
+
+        type = rhs.type;
+        data = rhs.data;
+
+        rhs.type = Generic;
+    }
+
+    return(*this);
+}
+
+void Variant::Release(void)
+{
+    if((type == WString) && (data.text->references.fetch_sub(1, std::memory_order_acq_rel) == 1))
+        delete(data.text);
 
-    data.ptr = string;
+    type = Generic;
 }
 
 bool Variant::operator==(const Variant &rhs) const
+/*------------------------------------------------------------------------------
+nots | . copies of a string share it, so they compare by pointer first.
+------------------------------------------------------------------------------*/
 {
-    return(this->ToWString() == rhs.ToWString());
+    if(type != rhs.type) return(this->ToWString() == rhs.ToWString());
+
+    switch(type)
+    {
+    case Bool : return(data.b == rhs.data.b);
+    case Int : return(data.i == rhs.data.i);
+    case Float : return(data.f == rhs.data.f);
+    case WString : return((data.text == rhs.data.text) || (GetWString() == rhs.GetWString()));
+    case Generic : return(true);
+    }
+
+    return(false);
 }
 
 bool Variant::operator<(const Variant &rhs) const
@@ -119,35 +191,157 @@ std::wstring Variant::ToWString(void) const
     return(L"");
 }
 
-std::wstring Variant::GetWString(void) const
+const std::wstring &Variant::GetWString(void) const
+{
+    return(data.text->wstring);
+}
+
+//------------------------------------------------------------------------| Attribute::Cache
+
+static const uint cacheBytes = 1024;
+
+Attribute::Cache::Cache(void) : next(0) {}
+
+Attribute::Cache::Cache(const Cache &/*rhs*/) : next(0) {}
+
+Attribute::Cache &Attribute::Cache::operator=(const Cache &/*rhs*/)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    entries.clear();
+    next = 0;
+
+    return(*this);
+}
+
+Attribute::Cache::Entry *Attribute::Cache::Find(const Key &key)
 {
-    std::wstring *wstring = static_cast<std::wstring *>(data.ptr);
+    for(Entry &entry : entries)
+    {
+        if((entry.key.version == key.version) && (entry.key.rows == key.rows) &&
+           (entry.key.restrictions == key.restrictions) && (entry.key.discrete == key.discrete))
+            return(&entry);
+    }
 
-    return(*wstring);
+    return(nullptr);
+}
+
+Attribute::Cache::Entry *Attribute::Cache::Replace(const Key &key)
+/*------------------------------------------------------------------------------
+nots | . entries are replaced round robin, which is oldest first.
+     | . as many entries are kept as fit in cacheBytes, one at least.
+------------------------------------------------------------------------------*/
+{
+    uint capacity = std::max<uint>(1, cacheBytes / sizeof(Entry));
+
+    Entry *entry = nullptr;
+
+    if(entries.size() < capacity)
+    {
+        entries.push_back(Entry());
+        entry = &entries.back();
+    }
+    else
+    {
+        entry = &entries[next];
+        *entry = Entry();
+
+        next = (next + 1) % capacity;
+    }
+
+    entry->key = key;
+    entry->known = 0;
+
+    return(entry);
 }
 
 //------------------------------------------------------------------------| Attribute
 
-Attribute::Attribute(const std::wstring &attribute, const bool discrete) :
-    name(attribute), discrete(discrete) {}
+Attribute::Attribute(const std::wstring &attribute, const bool discrete, const ubyte type) :
+    name(attribute), discrete(discrete), type(type) {}
+
+Attribute::~Attribute(void) {}
+
+const RowSet &Attribute::GetSelection(uint size, const DataFrameView *view, const RowSet &restrictions,
+    RowSet &selection)
+/*------------------------------------------------------------------------------
+desc | . rows of the view, or of the whole column, that satisfy the restrictions.
+nots | . an empty restriction does not restrict.
+     | . selection is only used as storage when a new set has to be built.
+------------------------------------------------------------------------------*/
+{
+    if(restrictions.IsEmpty())
+    {
+        if(view) return(view->rows);
+
+        selection = RowSet::GetRange(size);
+
+        return(selection);
+    }
+
+    if(view)
+        selection = view->rows.Intersection(restrictions);
+    else if(restrictions.Universe() > size)
+        selection = RowSet::GetRange(size).Intersection(restrictions);
+    else
+        return(restrictions);
+
+    return(selection);
+}
 
 uint Attribute::Size(void) {return(0);}
 
 bool Attribute::GetUniformity(void) {return(true);}
 
-Variant Attribute::GetMode(const std::vector<uint> &indexes)
+bool Attribute::GetUniformity(const DataFrameView &/*view*/) {return(true);}
+
+Variant Attribute::GetMode(const RowSet &/*indexes*/)
 {
     Variant variant(L"");
 
     return(variant);
 }
 
-float Attribute::GetAttributeEntropy(const std::vector<uint> &/*indexes*/) {return(0.0f);}
+Variant Attribute::GetMode(const DataFrameView &/*view*/, const RowSet &/*indexes*/)
+{
+    Variant variant(L"");
+
+    return(variant);
+}
+
+float Attribute::GetAttributeEntropy(const RowSet &/*indexes*/) {return(0.0f);}
+
+float Attribute::GetAttributeEntropy(const DataFrameView &/*view*/, const RowSet &/*indexes*/) {return(0.0f);}
+
+float Attribute::GetAttributeGiniIndex(const RowSet &/*indexes*/) {return(1.0f);}
 
-float Attribute::GetAttributeGiniIndex(const std::vector<uint> &/*indexes*/) {return(1.0f);}
+float Attribute::GetAttributeGiniIndex(const DataFrameView &/*view*/, const RowSet &/*indexes*/) {return(1.0f);}
 
 std::vector<Attribute::ProbabilityDistribution> *Attribute::GetProbabilityDistribution(
-    const std::vector<uint> &/*restriction*/) {return(nullptr);}
+    const RowSet &/*restriction*/) {return(nullptr);}
+
+std::vector<Attribute::ProbabilityDistribution> *Attribute::GetProbabilityDistribution(
+    const DataFrameView &/*view*/, const RowSet &/*restriction*/, std::vector <uint> */*codes*/) {return(nullptr);}
+
+uint Attribute::GetCodes(const DataFrameView &/*view*/, std::vector <uint> &codes)
+/*------------------------------------------------------------------------------
+desc | . code of the value of every row of the view, codes follow value order.
+------------------------------------------------------------------------------*/
+{
+    codes.clear();
+
+    return(0);
+}
+
+bool Attribute::GetSortedRows(const DataFrameView &/*view*/, std::vector <uint> &order)
+/*------------------------------------------------------------------------------
+desc | . rows of the view sorted by value and then by row, continuous attributes only.
+------------------------------------------------------------------------------*/
+{
+    order.clear();
+
+    return(false);
+}
 
 Variant Attribute::GetCell(uint index)
 {
@@ -156,210 +350,595 @@ Variant Attribute::GetCell(uint index)
     return(variant);
 }
 
-//------------------------------------------------------------------------| BoolAttribute
+//------------------------------------------------------------------------| Dictionary
+
+uint Dictionary::Size(void) const {return(values.size());}
+
+uint Dictionary::GetCode(const std::wstring &value)
+{
+    auto it = codes.find(value);
+
+    if(it != codes.end()) return(it->second);
+
+    uint code = values.size();
 
-BoolAttribute::BoolAttribute(const std::wstring &attribute) : Attribute(attribute, true) {}
+    values.push_back(value);
+    codes.insert(std::pair<std::wstring, uint>(value, code));
 
-uint BoolAttribute::Size(void) {return(cells.size());}
+    // '--> keep order sorted, new strings are rare compared to cells.
 
-bool BoolAttribute::GetUniformity(void)
+    auto position = std::lower_bound(order.begin(), order.end(), value,
+        [this](uint lhs, const std::wstring &rhs) {return(values[lhs] < rhs);});
+
+    order.insert(position, code);
+
+    return(code);
+}
+
+uint Dictionary::FindCode(const std::wstring &value) const
 {
-    for(uint i = 1, n = cells.size(); i < n; ++i)
-    {
-        if(cells[i] != cells.front())
-            return(false);
-    }
+    auto it = codes.find(value);
 
-    return(true);
+    if(it == codes.end()) return(-1);
+
+    return(it->second);
 }
 
-Variant BoolAttribute::GetMode(const std::vector<uint> &indexes)
+const std::wstring &Dictionary::GetValue(uint code) const {return(values[code]);}
+
+void Dictionary::Assign(std::vector <std::wstring> &values, std::vector <uint> &order)
+/*------------------------------------------------------------------------------
+nots | . takes the contents of values and order, order must already be sorted.
+------------------------------------------------------------------------------*/
 {
-    std::map<bool, int> frecuency = GetFrecuencyMapping<bool>(cells, indexes);
+    this->values.swap(values);
+    this->order.swap(order);
 
-    Variant variant(FrecuencyMode<bool>(frecuency));
+    codes.clear();
+    codes.reserve(this->values.size());
 
-    return(variant);
+    for(uint code = 0, n = this->values.size(); code < n; ++code)
+        codes.insert(std::pair<std::wstring, uint>(this->values[code], code));
+}
+
+//------------------------------------------------------------------------| ColumnCells
+
+void ColumnCells<bool>::GetCounts(const RowSet &rows, uint &falses, uint &trues) const
+/*------------------------------------------------------------------------------
+desc | . false and true cells of the rows.
+------------------------------------------------------------------------------*/
+{
+    trues = rows.IntersectionSize(cells.Words(), cells.size());
+    falses = rows.Size() - trues;
 }
 
-float BoolAttribute::GetAttributeEntropy(const std::vector<uint> &restrictions)
+void ColumnCells<std::wstring>::PushBack(const std::wstring &value)
 {
-    return(GetEntropy(cells, restrictions));
+    cells.push_back(dictionary.GetCode(value));
 }
 
-float BoolAttribute::GetAttributeGiniIndex(const std::vector<uint> &restrictions)
+const std::wstring &ColumnCells<std::wstring>::GetWString(uint index) const
 {
-    return(GetGiniIndex(cells, restrictions));
+    return(dictionary.GetValue(cells[index]));
 }
 
-std::vector<Attribute::ProbabilityDistribution> *BoolAttribute::GetProbabilityDistribution(
-    const std::vector<uint> &restriction)
+void ColumnCells<std::wstring>::SetWString(uint index, const std::wstring &value)
 {
-    return(GetDistributionFuncion<bool>(cells, restriction));
+    cells.Set(index, dictionary.GetCode(value));
 }
 
-Variant BoolAttribute::GetCell(uint index)
+std::vector <int> ColumnCells<std::wstring>::GetFrecuency(const RowSet &rows) const
+/*------------------------------------------------------------------------------
+desc | . rows of every dictionary code.
+------------------------------------------------------------------------------*/
 {
-    Variant variant(cells[index]);
+    std::vector <int> frecuency(dictionary.Size(), 0);
 
-    return(variant);
+    for(uint i : rows)
+        ++frecuency[cells[i]];
+
+    return(frecuency);
 }
 
-//------------------------------------------------------------------------| IntAttribute
+//------------------------------------------------------------------------| TypedColumn
 
-IntAttribute::IntAttribute(const std::wstring &attribute) : Attribute(attribute, false) {}
+template <class T> TypedColumn<T>::TypedColumn(const std::wstring &attribute) :
+    Attribute(attribute, ColumnTraits<T>::discrete, ColumnTraits<T>::type) {}
 
-uint IntAttribute::Size(void) {return(cells.size());}
+template <class T> uint TypedColumn<T>::Size(void) {return(cells.size());}
 
-bool IntAttribute::GetUniformity(void)
+template <class T> bool TypedColumn<T>::GetUniformity(void)
 {
-    for(uint i = 1, n = cells.size(); i < n; ++i)
-    {
-        if(cells[i] != cells.front())
-            return(false);
-    }
+    return(GetCached(nullptr, {}, Cache::Uniformity, &Cache::Entry::uniformity,
+        [this]() {return(GetCellUniformity(nullptr));}));
+}
 
-    return(true);
+template <class T> bool TypedColumn<T>::GetUniformity(const DataFrameView &view)
+{
+    return(GetCached(&view, {}, Cache::Uniformity, &Cache::Entry::uniformity,
+        [&]() {return(GetCellUniformity(&view));}));
 }
 
-Variant IntAttribute::GetMode(const std::vector<uint> &indexes)
+template <class T> Variant TypedColumn<T>::GetMode(const RowSet &indexes)
 {
-    std::map<int, int> frecuency = GetFrecuencyMapping<int>(cells, indexes);
+    return(GetCached(nullptr, indexes, Cache::Mode, &Cache::Entry::mode,
+        [&]() {return(GetCellMode(nullptr, indexes));}));
+}
 
-    Variant variant(FrecuencyMode<int>(frecuency));
+template <class T> Variant TypedColumn<T>::GetMode(const DataFrameView &view, const RowSet &indexes)
+{
+    return(GetCached(&view, indexes, Cache::Mode, &Cache::Entry::mode,
+        [&]() {return(GetCellMode(&view, indexes));}));
+}
 
-    return(variant);
+template <class T> float TypedColumn<T>::GetAttributeEntropy(const RowSet &restrictions)
+{
+    return(GetCached(nullptr, restrictions, Cache::Entropy, &Cache::Entry::entropy,
+        [&]() {return(GetCellEntropy(nullptr, restrictions));}));
 }
 
-float IntAttribute::GetAttributeEntropy(const std::vector<uint> &restrictions)
+template <class T> float TypedColumn<T>::GetAttributeEntropy(const DataFrameView &view, const RowSet &restrictions)
 {
-    return(GetEntropy(cells, restrictions));
+    return(GetCached(&view, restrictions, Cache::Entropy, &Cache::Entry::entropy,
+        [&]() {return(GetCellEntropy(&view, restrictions));}));
 }
 
-float IntAttribute::GetAttributeGiniIndex(const std::vector<uint> &restrictions)
+template <class T> float TypedColumn<T>::GetAttributeGiniIndex(const RowSet &restrictions)
 {
-    return(GetGiniIndex(cells, restrictions));
+    return(GetCached(nullptr, restrictions, Cache::GiniIndex, &Cache::Entry::giniIndex,
+        [&]() {return(GetCellGiniIndex(nullptr, restrictions));}));
 }
 
-std::vector<Attribute::ProbabilityDistribution> *IntAttribute::GetProbabilityDistribution(
-    const std::vector<uint> &restriction)
+template <class T> float TypedColumn<T>::GetAttributeGiniIndex(const DataFrameView &view, const RowSet &restrictions)
 {
-    if(discrete)
-        return(GetDistributionFuncion<int>(cells, restriction));
-    else
-        return(GetDensityFunction<int>(cells, restriction));
+    return(GetCached(&view, restrictions, Cache::GiniIndex, &Cache::Entry::giniIndex,
+        [&]() {return(GetCellGiniIndex(&view, restrictions));}));
 }
 
-Variant IntAttribute::GetCell(uint index)
+template <class T> std::vector<Attribute::ProbabilityDistribution> *TypedColumn<T>::GetProbabilityDistribution(
+    const RowSet &restriction)
 {
-    Variant variant(cells[index]);
+    return(GetCellDistribution(nullptr, restriction));
+}
 
-    return(variant);
+template <class T> std::vector<Attribute::ProbabilityDistribution> *TypedColumn<T>::GetProbabilityDistribution(
+    const DataFrameView &view, const RowSet &restriction, std::vector <uint> *codes)
+{
+    return(GetCellDistribution(&view, restriction, codes));
+}
+
+template <class T> uint TypedColumn<T>::GetCodes(const DataFrameView &view, std::vector <uint> &codes)
+{
+    return(GetValueCodes(cells, view, codes));
 }
 
-//------------------------------------------------------------------------| FloaAttribute
+template <class T> bool TypedColumn<T>::GetSortedRows(const DataFrameView &view, std::vector <uint> &order)
+{
+    if(discrete) return(Attribute::GetSortedRows(view, order));
 
-FloaAttribute::FloaAttribute(const std::wstring &attribute) : Attribute(attribute, false) {}
+    GetRowOrder(cells, view, order);
 
-uint FloaAttribute::Size(void) {return(cells.size());}
+    return(true);
+}
 
-bool FloaAttribute::GetUniformity(void)
+template <class T> Variant TypedColumn<T>::GetCell(uint index)
 {
-    for(uint i = 1, n = cells.size(); i < n; ++i)
-    {
-        if(cells[i] != cells.front())
-            return(false);
-    }
+    Variant variant(cells[index]);
+
+    return(variant);
+}
+
+template <class T> bool TypedColumn<T>::GetKey(const DataFrameView *view, const RowSet &restrictions,
+    Cache::Key &key) const
+/*------------------------------------------------------------------------------
+nots | . the rows of a distribution are named when it is built, so the queries of
+     |   the next level of a tree, on them or on views partitioned from them, hit.
+     | . restrictions without an id are built for one query, as the index lists
+     |   of a call, and are not cached : they could never be found again.
+------------------------------------------------------------------------------*/
+{
+    if(!restrictions.IsEmpty() && !restrictions.HasId()) return(false);
+
+    key.version = cells.Version();
+    key.rows = view ? view->rows.Id() : 0;
+    key.restrictions = restrictions.IsEmpty() ? 0 : restrictions.Id();
+    key.discrete = discrete;
 
     return(true);
 }
 
-Variant FloaAttribute::GetMode(const std::vector<uint> &indexes)
+template <class T> template <class V, class F> V TypedColumn<T>::GetCached(const DataFrameView *view,
+    const RowSet &restrictions, Cache::Field field, V Cache::Entry::*member, F compute)
 {
-    std::map<float, int> frecuency = GetFrecuencyMapping<float>(cells, indexes);
+    Cache::Key key;
 
-    Variant variant(FrecuencyMode<float>(frecuency));
+    if(!GetKey(view, restrictions, key)) return(compute());
 
-    return(variant);
+    return(cache.Get(key, field, member, compute));
+}
+
+template <class T> bool TypedColumn<T>::GetCellUniformity(const DataFrameView *view)
+{
+    return(IsUniform(cells, view));
+}
+
+template <class T> Variant TypedColumn<T>::GetCellMode(const DataFrameView *view, const RowSet &restrictions)
+{
+    return(GetFrecuencyMode(cells, view, restrictions));
 }
 
-float FloaAttribute::GetAttributeEntropy(const std::vector<uint> &restrictions)
+template <class T> float TypedColumn<T>::GetCellEntropy(const DataFrameView *view, const RowSet &restrictions)
 {
-    return(GetEntropy(cells, restrictions));
+    return(GetEntropy(cells, view, restrictions));
 }
 
-float FloaAttribute::GetAttributeGiniIndex(const std::vector<uint> &restrictions)
+template <class T> float TypedColumn<T>::GetCellGiniIndex(const DataFrameView *view, const RowSet &restrictions)
 {
-    return(GetGiniIndex(cells, restrictions));
+    return(GetGiniIndex(cells, view, restrictions));
 }
 
-std::vector<Attribute::ProbabilityDistribution> *FloaAttribute::GetProbabilityDistribution(
-    const std::vector<uint> &restriction)
+template <class T> std::vector<Attribute::ProbabilityDistribution> *TypedColumn<T>::GetCellDistribution(
+    const DataFrameView *view, const RowSet &restrictions, std::vector <uint> *codes)
 {
     if(discrete)
-        return(GetDistributionFuncion<float>(cells, restriction));
+        return(GetDistributionFuncion(cells, view, restrictions, codes));
     else
-        return(GetDensityFunction<float>(cells, restriction));
+        return(GetDensityFunction(cells, view, restrictions, codes));
 }
 
-Variant FloaAttribute::GetCell(uint index)
+//------------------------------------------------------------------------| TypedColumn <bool>
+
+template <> uint TypedColumn<bool>::GetCodes(const DataFrameView &view, std::vector <uint> &codes)
 {
-    Variant variant(cells[index]);
+    uint falses, trues;
 
-    return(variant);
+    GetCounts(view.rows, falses, trues);
+
+    codes.clear();
+    codes.reserve(view.Size());
+
+    for(uint i : view.rows)
+        codes.push_back((cells[i] && falses) ? 1 : 0);
+
+    return((falses ? 1 : 0) + (trues ? 1 : 0));
+}
+
+template <> bool TypedColumn<bool>::GetSortedRows(const DataFrameView &view, std::vector <uint> &order)
+{
+    return(Attribute::GetSortedRows(view, order));
 }
 
-//------------------------------------------------------------------------| WStringAttribute
+template <> bool TypedColumn<bool>::GetCellUniformity(const DataFrameView *view)
+{
+    RowSet selection;
 
-WStringAttribute::WStringAttribute(const std::wstring &attribute) : Attribute(attribute, true) {}
+    uint falses, trues;
 
-uint WStringAttribute::Size(void) {return(cells.size());}
+    GetCounts(GetSelection(cells.size(), view, {}, selection), falses, trues);
 
-bool WStringAttribute::GetUniformity(void)
+    return(!falses || !trues);
+}
+
+template <> Variant TypedColumn<bool>::GetCellMode(const DataFrameView *view, const RowSet &restrictions)
+/*------------------------------------------------------------------------------
+nots | . ties resolve to false, as the first value in order.
+------------------------------------------------------------------------------*/
 {
-    for(uint i = 1, n = cells.size(); i < n; ++i)
+    RowSet selection;
+
+    uint falses, trues;
+
+    GetCounts(GetSelection(cells.size(), view, restrictions, selection), falses, trues);
+
+    return(Variant(trues > falses));
+}
+
+template <> float TypedColumn<bool>::GetCellEntropy(const DataFrameView *view, const RowSet &restrictions)
+/*------------------------------------------------------------------------------
+nots | . values are visited in order, false first, as GetEntropy does.
+------------------------------------------------------------------------------*/
+{
+    RowSet selection;
+
+    uint falses, trues;
+
+    GetCounts(GetSelection(cells.size(), view, restrictions, selection), falses, trues);
+
+    int counts[2] = {(int)(falses), (int)(trues)};
+
+    float N = view ? view->Size() : cells.size();
+
+    return(Kernel::Entropy(counts, 2, N));
+}
+
+template <> float TypedColumn<bool>::GetCellGiniIndex(const DataFrameView *view, const RowSet &restrictions)
+{
+    RowSet selection;
+
+    uint falses, trues;
+
+    GetCounts(GetSelection(cells.size(), view, restrictions, selection), falses, trues);
+
+    int counts[2] = {(int)(falses), (int)(trues)};
+
+    float N = view ? view->Size() : cells.size();
+
+    return(Kernel::Gini(counts, 2, N));
+}
+
+template <> std::vector<Attribute::ProbabilityDistribution> *TypedColumn<bool>::GetCellDistribution(
+    const DataFrameView *view, const RowSet &restrictions, std::vector <uint> *codes)
+/*------------------------------------------------------------------------------
+vars | codes : if given, position in the distribution of every selected row
+nots | . only values present in the rows are in the distribution, false first.
+------------------------------------------------------------------------------*/
+{
+    std::vector <ProbabilityDistribution> *probabilityDistribution = new std::vector <ProbabilityDistribution>;
+
+    RowSet selection;
+
+    const RowSet &rows = GetSelection(cells.size(), view, restrictions, selection);
+
+    uint falses, trues;
+
+    GetCounts(rows, falses, trues);
+
+    float N = view ? view->Size() : cells.size();
+
+    if(falses) probabilityDistribution->push_back(ProbabilityDistribution(Variant(false), (float)(falses)/N));
+    if(trues) probabilityDistribution->push_back(ProbabilityDistribution(Variant(true), (float)(trues)/N));
+
+    if(codes)
     {
-        if(cells[i] != cells.front())
-            return(false);
+        codes->clear();
+        codes->reserve(rows.Size());
     }
 
-    return(true);
+    for(uint i : rows)
+    {
+        uint position = (cells[i] && falses) ? 1 : 0;
+
+        (*probabilityDistribution)[position].indexes.PushBack(i);
+
+        if(codes) codes->push_back(position);
+    }
+
+    for(ProbabilityDistribution &distribution : *probabilityDistribution)
+    {
+        distribution.indexes.Compact();
+        distribution.indexes.Id();
+    }
+
+    return(probabilityDistribution);
+}
+
+//------------------------------------------------------------------------| TypedColumn <std::wstring>
+
+template <> uint TypedColumn<std::wstring>::GetCodes(const DataFrameView &view, std::vector <uint> &codes)
+/*------------------------------------------------------------------------------
+nots | . dictionary codes are ranked by string, only values present in the view.
+------------------------------------------------------------------------------*/
+{
+    std::vector <uint> ranks(dictionary.Size(), 0);
+
+    for(uint i : view.rows)
+        ranks[cells[i]] = 1;
+
+    uint size = 0;
+
+    for(uint code : dictionary.order)
+    {
+        if(ranks[code]) ranks[code] = ++size;
+    }
+
+    codes.clear();
+    codes.reserve(view.Size());
+
+    for(uint i : view.rows)
+        codes.push_back(ranks[cells[i]] - 1);
+
+    return(size);
 }
 
-Variant WStringAttribute::GetMode(const std::vector<uint> &indexes)
+template <> bool TypedColumn<std::wstring>::GetSortedRows(const DataFrameView &view, std::vector <uint> &order)
 {
-    std::map<std::wstring, int> frecuency = GetFrecuencyMapping<std::wstring>(cells, indexes);
+    return(Attribute::GetSortedRows(view, order));
+}
 
-    Variant variant(FrecuencyMode<std::wstring>(frecuency));
+template <> Variant TypedColumn<std::wstring>::GetCell(uint index)
+{
+    Variant variant(GetWString(index));
 
     return(variant);
 }
 
-float WStringAttribute::GetAttributeEntropy(const std::vector<uint> &restrictions)
+template <> Variant TypedColumn<std::wstring>::GetCellMode(const DataFrameView *view, const RowSet &restrictions)
+/*------------------------------------------------------------------------------
+nots | . codes are visited in lexicographic order, so ties resolve as FrecuencyMode.
+------------------------------------------------------------------------------*/
 {
-    return(GetEntropy(cells, restrictions));
+    RowSet selection;
+
+    std::vector <int> frecuency = GetFrecuency(GetSelection(cells.size(), view, restrictions, selection));
+
+    int maximum = 0;
+    uint mode = -1;
+
+    for(uint code : dictionary.order)
+    {
+        if(frecuency[code] > maximum)
+        {
+            maximum = frecuency[code];
+            mode = code;
+        }
+    }
+
+    Variant variant((mode == (uint)(-1)) ? std::wstring() : dictionary.GetValue(mode));
+
+    return(variant);
 }
 
-float WStringAttribute::GetAttributeGiniIndex(const std::vector<uint> &restrictions)
+template <> float TypedColumn<std::wstring>::GetCellEntropy(const DataFrameView *view, const RowSet &restrictions)
 {
-    return(GetGiniIndex(cells, restrictions));
+    RowSet selection;
+
+    std::vector <int> frecuency = GetFrecuency(GetSelection(cells.size(), view, restrictions, selection));
+
+    std::vector <int> counts;
+
+    float N = view ? view->Size() : cells.size();
+
+    for(uint code : dictionary.order)
+        counts.push_back(frecuency[code]);
+
+    return(Kernel::Entropy(counts.data(), counts.size(), N));
 }
 
-std::vector<Attribute::ProbabilityDistribution> *WStringAttribute::GetProbabilityDistribution(
-    const std::vector<uint> &restriction)
+template <> float TypedColumn<std::wstring>::GetCellGiniIndex(const DataFrameView *view, const RowSet &restrictions)
 {
-    return(GetDistributionFuncion<std::wstring>(cells, restriction));
+    RowSet selection;
+
+    std::vector <int> frecuency = GetFrecuency(GetSelection(cells.size(), view, restrictions, selection));
+
+    std::vector <int> counts;
+
+    float N = view ? view->Size() : cells.size();
+
+    for(uint code : dictionary.order)
+        counts.push_back(frecuency[code]);
+
+    return(Kernel::Gini(counts.data(), counts.size(), N));
 }
 
-Variant WStringAttribute::GetCell(uint index)
+template <> std::vector<Attribute::ProbabilityDistribution> *TypedColumn<std::wstring>::GetCellDistribution(
+    const DataFrameView *view, const RowSet &restrictions, std::vector <uint> *codes)
 {
-    Variant variant(cells[index]);
+    std::vector <ProbabilityDistribution> *probabilityDistribution = new std::vector <ProbabilityDistribution>;
 
-    return(variant);
+    RowSet selection;
+
+    const RowSet &rows = GetSelection(cells.size(), view, restrictions, selection);
+
+    std::vector <int> frecuency = GetFrecuency(rows);
+
+    float N = view ? view->Size() : cells.size();
+
+    for(uint code : dictionary.order)
+    {
+        if(!frecuency[code]) continue;
+
+        probabilityDistribution->push_back(ProbabilityDistribution(dictionary.GetValue(code), (float)(frecuency[code])/N));
+
+        frecuency[code] = probabilityDistribution->size() - 1;
+    }
+
+    if(codes)
+    {
+        codes->clear();
+        codes->reserve(rows.Size());
+    }
+
+    for(uint i : rows)
+    {
+        (*probabilityDistribution)[frecuency[cells[i]]].indexes.PushBack(i);
+
+        if(codes) codes->push_back(frecuency[cells[i]]);
+    }
+
+    for(ProbabilityDistribution &distribution : *probabilityDistribution)
+    {
+        distribution.indexes.Compact();
+        distribution.indexes.Id();
+    }
+
+    return(probabilityDistribution);
+}
+
+template struct ML::TypedColumn <bool>;
+template struct ML::TypedColumn <int>;
+template struct ML::TypedColumn <float>;
+template struct ML::TypedColumn <std::wstring>;
+
+//------------------------------------------------------------------------| Schema
+
+Schema::Schema(void) : size(-1) {}
+
+Schema::Schema(const Schema &/*rhs*/) : size(-1) {}
+
+Schema &Schema::operator=(const Schema &/*rhs*/)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    index.clear();
+    size = -1;
+
+    return(*this);
+}
+
+uint Schema::Find(const std::vector <Attribute *> &attributes, const std::wstring &name) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if(size != attributes.size()) Build(attributes);
+
+    auto it = index.find(name);
+
+    if((it != index.end()) && (attributes[it->second]->name == name)) return(it->second);
+
+    // '--> attributes may have been replaced or renamed in place.
+
+    Build(attributes);
+
+    it = index.find(name);
+
+    return((it != index.end()) ? it->second : -1);
+}
+
+void Schema::Build(const std::vector <Attribute *> &attributes) const
+{
+    index.clear();
+    index.reserve(attributes.size());
+
+    for(uint i = 0, n = attributes.size(); i < n; ++i)
+        index.insert(std::pair<std::wstring, uint>(attributes[i]->name, i));
+
+    size = attributes.size();
 }
 
 //------------------------------------------------------------------------| DataFrame
 
+template <class C> static void GatherCells(const C &source, const std::vector <uint> &rows, C &target)
+{
+    target.reserve(rows.size());
+
+    for(uint i = 0, n = rows.size(); (i < n) && (rows[i] < source.size()); ++i)
+        target.push_back(source[rows[i]]);
+}
+
+struct SubColumn
+/*------------------------------------------------------------------------------
+desc | . visitor that gathers the rows of a typed column into a new one.
+------------------------------------------------------------------------------*/
+{
+    const std::vector <uint> &rows;
+
+    Attribute *column;
+
+    SubColumn(const std::vector <uint> &rows) : rows(rows), column(nullptr) {}
+
+    template <class T> void operator()(const TypedColumn <T> &source)
+    {
+        TypedColumn <T> *target = new TypedColumn <T>(source.name);
+
+        target->discrete = source.discrete;
+        target->CopyDomain(source);
+
+        GatherCells(source.cells, rows, target->cells);
+
+        column = target;
+    }
+};
+
 DataFrame::DataFrame(void) {}
 
 uint DataFrame::Size(void)
@@ -377,114 +956,155 @@ void DataFrame::Clear(void)
     clrptrvector<Attribute *>(attributes);
 }
 
-ubyte DataFrame::GetColumnByAttribute(const std::wstring &attribute)
+uint DataFrame::GetColumnByAttribute(const std::wstring &attribute)
+/*------------------------------------------------------------------------------
+nots | . returns -1 if there is no such attribute.
+------------------------------------------------------------------------------*/
 {
-    for(ubyte i = 0, n = attributes.size(); i < n; ++i)
-    {
-        if(attributes[i]->name == attribute)
-            return(i);
-    }
-
-    return(-1);
+    return(schema.Find(attributes, attribute));
 }
 
-ubyte DataFrame::GetColumnType(ubyte index)
+uint DataFrame::GetColumnByAttribute(const std::wstring &attribute, uint column)
+/*------------------------------------------------------------------------------
+nots | . column is tried first, as the id the attribute had in another dataframe.
+------------------------------------------------------------------------------*/
 {
-    BoolAttribute *boolFactor = dynamic_cast<BoolAttribute *>(attributes[index]);
+    if((column < attributes.size()) && (attributes[column]->name == attribute)) return(column);
+
+    return(schema.Find(attributes, attribute));
+}
 
-    if(boolFactor) return(BoolType);
+ubyte DataFrame::GetColumnType(uint index)
+{
+    return(attributes[index]->type);
+}
 
-    IntAttribute *intFactor = dynamic_cast<IntAttribute *>(attributes[index]);
+DataFrame *DataFrame::GetSubDataFrame(const std::vector <uint> &indexes)
+/*------------------------------------------------------------------------------
+nots | . cells are gathered in one pass, rows keep the order of the source.
+------------------------------------------------------------------------------*/
+{
+    DataFrame *dataframe = new DataFrame();
 
-    if(intFactor) return(IntType);
+    std::vector <uint> rows(indexes);
 
-    FloaAttribute *floatFactor = dynamic_cast<FloaAttribute *>(attributes[index]);
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
 
-    if(floatFactor) return(FloatType);
+    for(uint i = 0, n = attributes.size(); i < n; ++i)
+    {
+        SubColumn subcolumn(rows);
 
-    WStringAttribute *wstringFactor = dynamic_cast<WStringAttribute *>(attributes[index]);
+        Visit(attributes[i], subcolumn);
 
-    if(wstringFactor) return(WStringType);
+        dataframe->attributes.push_back(subcolumn.column);
+    }
 
-    return(GenericType);
+    return(dataframe);
 }
 
-DataFrame *DataFrame::GetSubDataFrame(const std::vector <uint> &indexes)
+//------------------------------------------------------------------------| DataFrameView
+
+DataFrameView::DataFrameView(DataFrame *dataframe) : dataframe(dataframe),
+    rows(RowSet::GetRange(dataframe->Size())) {}
+
+DataFrameView::DataFrameView(DataFrame *dataframe, const RowSet &rows) :
+    dataframe(dataframe), rows(rows) {}
+
+uint DataFrameView::Size(void) const {return(rows.Size());}
+
+void DataFrameView::Presort(void)
+/*------------------------------------------------------------------------------
+nots | . sorts every continuous attribute once, subviews only partition them.
+------------------------------------------------------------------------------*/
 {
-    DataFrame *dataframe = new DataFrame();
+    orders.clear();
 
-    for(ubyte i = 0, n = attributes.size(); i < n; ++i)
+    for(Attribute *attribute : dataframe->attributes)
     {
-        Attribute *factor = nullptr;
+        std::shared_ptr<std::vector <uint>> order = std::make_shared<std::vector <uint>>();
 
-        switch(GetColumnType(i))
-        {
-        case BoolType :
-        {
-            BoolAttribute *source = dynamic_cast<BoolAttribute *>(attributes[i]);
-            BoolAttribute *target = new BoolAttribute(*source);
+        if(attribute->GetSortedRows(*this, *order))
+            orders.push_back(Order{attribute, order});
+    }
 
-            for(uint j = 0, m = target->cells.size(); j < m; ++j)
-            {
-                if(std::find(indexes.begin(), indexes.end(), m - j - 1) == indexes.end())
-                    target->cells.erase(target->cells.begin() + m - j - 1);
-            }
+    std::sort(orders.begin(), orders.end(), [](const Order &a, const Order &b) {return(a.attribute < b.attribute);});
+}
 
-            factor = target;
+const std::vector <uint> *DataFrameView::GetOrder(const Attribute *attribute) const
+{
+    auto it = std::lower_bound(orders.begin(), orders.end(), attribute,
+        [](const Order &order, const Attribute *attribute) {return(order.attribute < attribute);});
 
-            break;
-        }
-        case IntType :
-        {
-            IntAttribute *source = dynamic_cast<IntAttribute *>(attributes[i]);
-            IntAttribute *target = new IntAttribute(*source);
+    if((it == orders.end()) || (it->attribute != attribute)) return(nullptr);
 
-            for(uint j = 0, m = target->cells.size(); j < m; ++j)
-            {
-                if(std::find(indexes.begin(), indexes.end(), m - j - 1) == indexes.end())
-                    target->cells.erase(target->cells.begin() + m - j - 1);
-            }
+    return(it->rows.get());
+}
 
-            factor = target;
+DataFrameView DataFrameView::GetSubView(const RowSet &indexes) const
+/*------------------------------------------------------------------------------
+nots | . indexes come from attribute queries on this view, so they already refer
+     |   to the base dataframe and are in ascending order.
+------------------------------------------------------------------------------*/
+{
+    return(Partition({&indexes}).front());
+}
 
-            break;
-        }
-        case FloatType :
-        {
-            FloaAttribute *source = dynamic_cast<FloaAttribute *>(attributes[i]);
-            FloaAttribute *target = new FloaAttribute(*source);
+std::vector <DataFrameView> DataFrameView::Partition(const std::vector <const RowSet *> &parts) const
+/*------------------------------------------------------------------------------
+desc | . one subview by part, parts are disjoint subsets of the rows of the view.
+nots | . every order is split in a single pass, keeping its relative order.
+     | . labels is scratch of the size of the base dataframe kept by thread, only
+     |   the rows of the view are written and read.
+------------------------------------------------------------------------------*/
+{
+    std::vector <DataFrameView> subviews;
 
-            for(uint j = 0, m = target->cells.size(); j < m; ++j)
-            {
-                if(std::find(indexes.begin(), indexes.end(), m - j - 1) == indexes.end())
-                    target->cells.erase(target->cells.begin() + m - j - 1);
-            }
+    subviews.reserve(parts.size());
 
-            factor = target;
+    for(const RowSet *part : parts)
+        subviews.push_back(DataFrameView(dataframe, *part));
 
-            break;
-        }
-        case WStringType :
-        {
-            WStringAttribute *source = dynamic_cast<WStringAttribute *>(attributes[i]);
-            WStringAttribute *target = new WStringAttribute(*source);
+    if(orders.empty()) return(subviews);
 
-            for(uint j = 0, m = target->cells.size(); j < m; ++j)
-            {
-                if(std::find(indexes.begin(), indexes.end(), m - j - 1) == indexes.end())
-                    target->cells.erase(target->cells.begin() + m - j - 1);
-            }
+    static thread_local std::vector <uint> labels;
+
+    if(labels.size() < dataframe->Size()) labels.resize(dataframe->Size());
+
+    for(uint i : rows)
+        labels[i] = -1;
 
-            factor = target;
+    for(uint k = 0, n = parts.size(); k < n; ++k)
+    {
+        for(uint i : *parts[k])
+            labels[i] = k;
+    }
+
+    for(const Order &order : orders)
+    {
+        std::vector <std::shared_ptr<std::vector <uint>>> suborders(parts.size());
 
-            break;
+        for(uint k = 0, n = parts.size(); k < n; ++k)
+        {
+            suborders[k] = std::make_shared<std::vector <uint>>();
+            suborders[k]->reserve(parts[k]->Size());
         }
+
+        for(uint i : *order.rows)
+        {
+            if(labels[i] != (uint)-1) suborders[labels[i]]->push_back(i);
         }
 
-        dataframe->attributes.push_back(factor);
+        for(uint k = 0, n = parts.size(); k < n; ++k)
+            subviews[k].orders.push_back(Order{order.attribute, suborders[k]});
     }
 
-    return(dataframe);
+    return(subviews);
+}
+
+DataFrame *DataFrameView::GetDataFrame(void) const
+{
+    return(dataframe->GetSubDataFrame(rows.ToVector()));
 }
 
 //------------------------------------------------------------------------| Common
@@ -502,3 +1122,96 @@ bool ML::Validate(Variant &a, MathOp &mathop, Variant &b)
 
     return(false);
 }
+
+void ML::EncodeUTF8(const std::wstring &wstring, std::string &string)
+/*------------------------------------------------------------------------------
+nots | . a 16 bit wchar_t is taken as UTF-16.
+------------------------------------------------------------------------------*/
+{
+    string.clear();
+
+    for(size_t i = 0, n = wstring.size(); i < n; ++i)
+    {
+        uint32_t c = (uint32_t)(wstring[i]);
+
+        if((sizeof(wchar_t) == 2) && (c >= 0xD800) && (c < 0xDC00) && (i + 1 < n))
+        {
+            uint32_t low = (uint32_t)(wstring[i + 1]);
+
+            if((low >= 0xDC00) && (low < 0xE000))
+            {
+                c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                ++i;
+            }
+        }
+
+        if(c < 0x80)
+            string.push_back((char)(c));
+        else if(c < 0x800)
+        {
+            string.push_back((char)(0xC0 | (c >> 6)));
+            string.push_back((char)(0x80 | (c & 0x3F)));
+        }
+        else if(c < 0x10000)
+        {
+            string.push_back((char)(0xE0 | (c >> 12)));
+            string.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+            string.push_back((char)(0x80 | (c & 0x3F)));
+        }
+        else
+        {
+            string.push_back((char)(0xF0 | (c >> 18)));
+            string.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+            string.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+            string.push_back((char)(0x80 | (c & 0x3F)));
+        }
+    }
+}
+
+bool ML::DecodeUTF8(const unsigned char *string, uint64_t size, std::wstring &wstring)
+{
+    wstring.clear();
+
+    for(uint64_t i = 0; i < size;)
+    {
+        uint32_t c = string[i];
+        uint32_t length = (c < 0x80) ? 1 : ((c >> 5) == 0x06) ? 2 : ((c >> 4) == 0x0E) ? 3 : ((c >> 3) == 0x1E) ? 4 : 0;
+
+        if(!length || (i + length > size)) return(false);
+
+        if(length > 1) c &= (0x7F >> length);
+
+        for(uint32_t k = 1; k < length; ++k)
+        {
+            if((string[i + k] & 0xC0) != 0x80) return(false);
+
+            c = (c << 6) | (string[i + k] & 0x3F);
+        }
+
+        i += length;
+
+        if((sizeof(wchar_t) == 2) && (c >= 0x10000))
+        {
+            wstring.push_back((wchar_t)(0xD800 + ((c - 0x10000) >> 10)));
+            wstring.push_back((wchar_t)(0xDC00 + ((c - 0x10000) & 0x3FF)));
+        }
+        else
+            wstring.push_back((wchar_t)(c));
+    }
+
+    return(true);
+}
+
+FILE *ML::OpenFile(const std::wstring &path, const wchar_t *mode)
+{
+#if defined(_WIN32)
+    return(_wfopen(path.c_str(), mode));
+#else
+    std::string narrowPath, narrowMode;
+
+    EncodeUTF8(path, narrowPath);
+    EncodeUTF8(mode, narrowMode);
+
+    return(fopen(narrowPath.c_str(), narrowMode.c_str()));
+#endif
+}
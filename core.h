@@ -6,9 +6,19 @@ auth | Roberto Peribáñez Iglesias (ergocortex) on Dec. 2018
 #define CORE_H
 
 #include <map>
+#include <memory>
+#include <cstdio>
 #include <vector>
+#include <mutex>
+#include <atomic>
 #include <string>
 #include <algorithm>
+#include <unordered_map>
+
+#include "rowset.h"
+#include "counter.h"
+#include "cells.h"
+#include "kernel.h"
 
 typedef unsigned char ubyte;
 typedef unsigned int  uint;
@@ -122,18 +132,35 @@ typedef ubyte MathOp;
 struct Variant
 /*------------------------------------------------------------------------------
 desc | . simulates dynamic typing
+nots | . strings are immutable and reference counted : copies share the string,
+     |   the last variant holding it frees it, and no lock is ever taken.
+     | . values of the same type compare directly, values of different types by
+     |   their ToWString.
 ------------------------------------------------------------------------------*/
 {
 public :
 
     enum Type {Generic, Bool, Int, Float, WString};
 
+    struct Text
+    {
+    public :
+
+        std::atomic <uint> references;
+
+        const std::wstring wstring;
+
+    public :
+
+        Text(const std::wstring &wstring) : references(1), wstring(wstring) {}
+    };
+
     union Data
     {
         bool b;
         int i;
         float f;
-        void *ptr;
+        Text *text;
     };
 
 public :
@@ -149,6 +176,14 @@ public :
     Variant(float f);
     Variant(const std::wstring &wstring);
 
+    Variant(const Variant &rhs);
+    Variant(Variant &&rhs);
+
+    ~Variant(void);
+
+    Variant &operator=(const Variant &rhs);
+    Variant &operator=(Variant &&rhs);
+
     bool operator==(const Variant &rhs) const;
     bool operator<(const Variant &rhs) const;
     bool operator<=(const Variant &rhs) const;
@@ -161,14 +196,67 @@ public :
 
 private :
 
-    std::wstring GetWString(void) const;
+    const std::wstring &GetWString(void) const;
+
+    void Release(void);
+};
+
+//------------------------------------------------------------------------| DataFrameView
+
+struct DataFrame;
+struct Attribute;
+
+struct DataFrameView
+/*------------------------------------------------------------------------------
+desc | . selection of rows over a base dataframe, cells are never copied.
+vars | orders : rows of the view sorted by value, by continuous attribute
+nots | . rows are indexes of the base dataframe in ascending order.
+     | . indexes returned by attribute queries on a view refer to the base dataframe.
+     | . orders are built once by Presort and inherited by subviews through a
+     |   stable partition, so they stay sorted by value and then by row.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    struct Order
+    {
+    public :
+
+        const Attribute *attribute;
+
+        std::shared_ptr<const std::vector <uint>> rows;
+    };
+
+public :
+
+    DataFrame *dataframe;
+
+    RowSet rows;
+
+    std::vector <Order> orders;
+
+public :
+
+    DataFrameView(DataFrame *dataframe);
+    DataFrameView(DataFrame *dataframe, const RowSet &rows);
+
+    uint Size(void) const;
+
+    void Presort(void);
+    const std::vector <uint> *GetOrder(const Attribute *attribute) const;
+
+    DataFrameView GetSubView(const RowSet &indexes) const;
+    std::vector <DataFrameView> Partition(const std::vector <const RowSet *> &parts) const;
+    DataFrame *GetDataFrame(void) const;
 };
 
 //------------------------------------------------------------------------| Attribute
 
 struct Attribute
 /*------------------------------------------------------------------------------
+vars | type : Variant::Type of the cells, Generic for an untyped attribute
 nots | . entropy in samples with more than 2 classes can be greater than 1.
+     | . typed attributes are TypedColumn <T>, type tells which T without RTTI.
 ------------------------------------------------------------------------------*/
 {
 public :
@@ -181,184 +269,339 @@ public :
         float p;
         MathOp mathop;
 
-        std::vector <uint> indexes;
+        RowSet indexes;
 
     public :
 
         ProbabilityDistribution(Variant value, float p, MathOp mathop = 0) : value(value), p(p), mathop(mathop) {}
     };
 
+    class Cache
+    /*--------------------------------------------------------------------------
+    desc | . scalar query results of a column on some rows, kept for the next query.
+    vars | key : version of the cells, ids of the rows of the view and of the
+         |       restrictions, 0 for the whole column or no restriction
+         | known : Field flags of the results present in an entry
+    nots | . holds the last keys that fit in a few hundred bytes, the oldest is
+         |   replaced by a new one.
+         | . distributions are not kept, they hold rows and are handed out to be
+         |   owned, so a hit would still copy them. Their rows carry an id, so the
+         |   queries restricted to them are kept.
+         | . any change of the cells changes their version, so entries computed
+         |   before it are never found again.
+         | . results are computed out of the lock, concurrent misses compute twice.
+         | . may be queried concurrently, copies start empty.
+    --------------------------------------------------------------------------*/
+    {
+    public :
+
+        struct Key
+        {
+            uint64_t version;
+            uint64_t rows;
+            uint64_t restrictions;
+            bool discrete;
+        };
+
+        enum Field {Uniformity = 1, Mode = 2, Entropy = 4, GiniIndex = 8};
+
+        struct Entry
+        {
+            Key key;
+            ubyte known;
+
+            bool uniformity;
+            Variant mode;
+            float entropy;
+            float giniIndex;
+        };
+
+    public :
+
+        Cache(void);
+        Cache(const Cache &rhs);
+
+        Cache &operator=(const Cache &rhs);
+
+        template <class V, class F> V Get(const Key &key, Field field, V Entry::*member, F compute)
+        {
+            {
+                std::lock_guard <std::mutex> lock(mutex);
+
+                Entry *entry = Find(key);
+
+                if(entry && (entry->known & field)) return(entry->*member);
+            }
+
+            V value = compute();
+
+            std::lock_guard <std::mutex> lock(mutex);
+
+            Entry *entry = Find(key);
+
+            if(!entry) entry = Replace(key);
+
+            entry->*member = value;
+            entry->known |= field;
+
+            return(value);
+        }
+
+    private :
+
+        std::mutex mutex;
+        std::vector <Entry> entries;
+
+        uint next;
+
+    private :
+
+        Entry *Find(const Key &key);
+        Entry *Replace(const Key &key);
+    };
+
 public :
 
     std::wstring name;
     bool discrete;
 
+    ubyte type;
+
 public :
 
-    Attribute(const std::wstring &name, const bool discrete);
+    Attribute(const std::wstring &name, const bool discrete, const ubyte type = Variant::Generic);
+    virtual ~Attribute(void);
 
 protected :
 
-    template <class T> std::map<T, int> GetFrecuencyMapping(const std::vector <T> &cells,
-        const std::vector<uint> &restrictions = {})
-    /*--------------------------------------------------------------------------
-    vars | indexes : index mapping restriction
-    --------------------------------------------------------------------------*/
+    Cache cache;
+
+protected :
+
+    static const RowSet &GetSelection(uint size, const DataFrameView *view, const RowSet &restrictions,
+        RowSet &selection);
+
+    template <class T> bool IsUniform(const Cells <T> &cells, const DataFrameView *view = nullptr)
     {
-        std::map<T, int> frecuency;
+        RowSet selection;
 
-        if(restrictions.empty())
-        {
-            for(uint i = 0, n = cells.size(); i < n; ++i)
-                FrecuencyMapping<T>(frecuency, cells[i]);
-        }
-        else
+        const RowSet &rows = GetSelection(cells.size(), view, {}, selection);
+
+        if(rows.IsEmpty()) return(true);
+
+        const T &first = cells[*rows.begin()];
+
+        for(uint i : rows)
         {
-            for(uint i = 0, n = cells.size(); i < n; ++i)
-            {
-                if(std::find(restrictions.begin(), restrictions.end(), i) != restrictions.end())
-                    FrecuencyMapping<T>(frecuency, cells[i]);
-            }
+            if(cells[i] != first)
+                return(false);
         }
 
-        return(frecuency);
+        return(true);
+    }
+
+    template <class T> Variant GetFrecuencyMode(const Cells <T> &cells, const DataFrameView *view,
+        const RowSet &restrictions = {})
+    {
+        RowSet selection;
+
+        FrecuencyCounter<T> frecuency(cells, GetSelection(cells.size(), view, restrictions, selection));
+
+        int index = frecuency.GetMaximum();
+
+        Variant variant((index < 0) ? T() : frecuency.GetFrecuency()[index].first);
+
+        return(variant);
+    }
+
+    template <class T> void GetRowOrder(const Cells <T> &cells, const DataFrameView &view,
+        std::vector <uint> &order)
+    {
+        order.clear();
+        order.reserve(view.Size());
+
+        for(uint i : view.rows)
+            order.push_back(i);
+
+        std::stable_sort(order.begin(), order.end(), [&cells](uint a, uint b) {return(cells[a] < cells[b]);});
+    }
+
+    template <class T> uint GetValueCodes(const Cells <T> &cells, const DataFrameView &view,
+        std::vector <uint> &codes)
+    {
+        FrecuencyCounter<T> frecuency(cells, view.rows);
+
+        codes.clear();
+        codes.reserve(view.Size());
+
+        for(uint i : view.rows)
+            codes.push_back(frecuency.GetPosition(cells[i]));
+
+        return(frecuency.Size());
     }
 
     template <class T> std::vector<ProbabilityDistribution> *GetDistributionFuncion(
-        const std::vector <T> &cells, const std::vector<uint> &restrictions = {})
+        const Cells <T> &cells, const DataFrameView *view, const RowSet &restrictions = {},
+        std::vector <uint> *codes = nullptr)
     /*--------------------------------------------------------------------------
+    vars | codes : if given, position in the distribution of every selected row
     nots | . for discrete variables, based on distribution function.
     --------------------------------------------------------------------------*/
     {
         std::vector <ProbabilityDistribution> *probabilityDistribution = new std::vector <ProbabilityDistribution>;
 
-        std::map<T, int> frecuency = GetFrecuencyMapping<T>(cells, restrictions);
+        RowSet selection;
 
-        float N = cells.size();
+        const RowSet &rows = GetSelection(cells.size(), view, restrictions, selection);
 
-        for(auto it : frecuency)
-        {
+        FrecuencyCounter<T> frecuency(cells, rows);
+
+        float N = view ? view->Size() : cells.size();
+
+        for(auto &it : frecuency.GetFrecuency())
             probabilityDistribution->push_back(ProbabilityDistribution(it.first, (float)(it.second)/N));
 
-            if(restrictions.empty())
-            {
-                for(uint i = 0, n = cells.size(); i < n; ++i)
-                {
-                    if(cells[i] == it.first)
-                        probabilityDistribution->back().indexes.push_back(i);
-                }
-            }
-            else
-            {
-                for(uint i = 0, n = cells.size(); i < n; ++i)
-                {
-                    if(std::find(restrictions.begin(), restrictions.end(), i) != restrictions.end())
-                    {
-                        if(cells[i] == it.first)
-                            probabilityDistribution->back().indexes.push_back(i);
-                    }
-                }
-            }
+        if(codes)
+        {
+            codes->clear();
+            codes->reserve(rows.Size());
+        }
+
+        for(uint i : rows)
+        {
+            uint position = frecuency.GetPosition(cells[i]);
+
+            (*probabilityDistribution)[position].indexes.PushBack(i);
+
+            if(codes) codes->push_back(position);
+        }
+
+        for(ProbabilityDistribution &distribution : *probabilityDistribution)
+        {
+            distribution.indexes.Compact();
+            distribution.indexes.Id();
         }
 
         return(probabilityDistribution);
     }
 
     template <class T> std::vector<ProbabilityDistribution> *GetDensityFunction(
-        const std::vector <T> &cells, const std::vector<uint> &restrictions = {})
+        const Cells <T> &cells, const DataFrameView *view, const RowSet &restrictions = {},
+        std::vector <uint> *codes = nullptr)
     /*--------------------------------------------------------------------------
+    vars | codes : if given, position in the distribution of every selected row
     nots | . for continuous variables, based on density function.
+         | . the median needs order, so selected values are sorted instead of counted,
+         |   unless the view carries the order of the attribute.
     --------------------------------------------------------------------------*/
     {
         std::vector <ProbabilityDistribution> *probabilityDistribution = new std::vector <ProbabilityDistribution>;
 
-        std::map<T, int> frecuency = GetFrecuencyMapping<T>(cells, restrictions);
+        RowSet selection;
 
-        uint N = cells.size();
+        const RowSet &rows = GetSelection(cells.size(), view, restrictions, selection);
 
-        typename std::map<T, int>::iterator it;
+        const std::vector <uint> *order = (view && restrictions.IsEmpty()) ? view->GetOrder(this) : nullptr;
+
+        std::vector <T> sorted;
+
+        sorted.reserve(rows.Size());
+
+        if(order)
+        {
+            for(uint i : *order)
+                sorted.push_back(cells[i]);
+        }
+        else
+        {
+            for(uint i : rows)
+                sorted.push_back(cells[i]);
+        }
+
+        if(sorted.empty()) return(probabilityDistribution);
+
+        if(!order) std::sort(sorted.begin(), sorted.end());
+
+        uint N = view ? view->Size() : cells.size();
+
+        T median;
 
         if(N > 1)
         {
             uint p, q;
 
-            it = FrecuencyMedian<T>(frecuency, N, p);
+            median = *FrecuencyMedian<T>(sorted, N, p);
 
             q = N - p;
 
-            probabilityDistribution->push_back(ProbabilityDistribution(it->first, (float)(p)/(float)(N), 1));
-            probabilityDistribution->push_back(ProbabilityDistribution(it->first, (float)(q)/(float)(N), 3));
+            probabilityDistribution->push_back(ProbabilityDistribution(median, (float)(p)/(float)(N), 1));
+            probabilityDistribution->push_back(ProbabilityDistribution(median, (float)(q)/(float)(N), 3));
         }
         else
         {
-            it = frecuency.begin();
+            median = sorted.front();
 
-            probabilityDistribution->push_back(ProbabilityDistribution(it->first, 1.0f, 0));
+            probabilityDistribution->push_back(ProbabilityDistribution(median, 1.0f, 0));
         }
 
-        if(restrictions.empty())
+        if(codes)
         {
-            for(uint i = 0, n = cells.size(); i < n; ++i)
-            {
-                if(cells[i] < it->first)
-                    probabilityDistribution->front().indexes.push_back(i);
-                else
-                    probabilityDistribution->back().indexes.push_back(i);
-            }
+            codes->clear();
+            codes->reserve(rows.Size());
         }
-        else
+
+        uint last = probabilityDistribution->size() - 1;
+
+        for(uint i : rows)
         {
-            for(uint i = 0, n = cells.size(); i < n; ++i)
-            {
-                if(std::find(restrictions.begin(), restrictions.end(), i) != restrictions.end())
-                {
-                    if(cells[i] < it->first)
-                        probabilityDistribution->front().indexes.push_back(i);
-                    else
-                        probabilityDistribution->back().indexes.push_back(i);
-                }
-            }
+            uint position = (cells[i] < median) ? 0 : last;
+
+            (*probabilityDistribution)[position].indexes.PushBack(i);
+
+            if(codes) codes->push_back(position);
+        }
+
+        for(ProbabilityDistribution &distribution : *probabilityDistribution)
+        {
+            distribution.indexes.Compact();
+            distribution.indexes.Id();
         }
 
         return(probabilityDistribution);
     }
 
-    template <class T> float GetEntropy(const std::vector <T> &cells,
-        const std::vector <uint> &restrictions)
+    template <class T> float GetEntropy(const Cells <T> &cells, const DataFrameView *view,
+        const RowSet &restrictions)
     {
-        std::map<T, int> frecuency = GetFrecuencyMapping<T>(cells, restrictions);
+        RowSet selection;
 
-        std::vector<float> proportion;
+        FrecuencyCounter<T> frecuency(cells, GetSelection(cells.size(), view, restrictions, selection));
 
-        float entropy = 0.0f;
-        float N = cells.size();
+        std::vector <int> counts;
 
-        for(auto it : frecuency)
-            proportion.push_back((float)(it.second)/N);
+        float N = view ? view->Size() : cells.size();
 
-        for(float p : proportion)
-            entropy -= (p * log2(p));
+        for(auto &it : frecuency.GetFrecuency())
+            counts.push_back(it.second);
 
-        return(entropy);
+        return(Kernel::Entropy(counts.data(), counts.size(), N));
     }
 
-    template <class T> float GetGiniIndex(const std::vector <T> &cells,
-        const std::vector <uint> &restrictions)
+    template <class T> float GetGiniIndex(const Cells <T> &cells, const DataFrameView *view,
+        const RowSet &restrictions)
     {
-        std::map<T, int> frecuency = GetFrecuencyMapping<T>(cells, restrictions);
+        RowSet selection;
 
-        std::vector<float> proportion;
+        FrecuencyCounter<T> frecuency(cells, GetSelection(cells.size(), view, restrictions, selection));
 
-        float gini = 1.0f;
-        float N = cells.size();
+        std::vector <int> counts;
 
-        for(auto it : frecuency)
-            proportion.push_back((float)(it.second)/N);
+        float N = view ? view->Size() : cells.size();
 
-        for(float p : proportion)
-            gini -= (p * p);
+        for(auto &it : frecuency.GetFrecuency())
+            counts.push_back(it.second);
 
-        return(gini);
+        return(Kernel::Gini(counts.data(), counts.size(), N));
     }
 
 public :
@@ -366,126 +609,259 @@ public :
     virtual uint Size(void);
 
     virtual bool GetUniformity(void);
-    virtual Variant GetMode(const std::vector<uint> &indexes = {});
+    virtual bool GetUniformity(const DataFrameView &view);
 
-    virtual float GetAttributeEntropy(const std::vector<uint> &restrictions = {});
-    virtual float GetAttributeGiniIndex(const std::vector<uint> &restrictions = {});
+    virtual Variant GetMode(const RowSet &indexes = {});
+    virtual Variant GetMode(const DataFrameView &view, const RowSet &indexes = {});
 
+    virtual float GetAttributeEntropy(const RowSet &restrictions = {});
+    virtual float GetAttributeEntropy(const DataFrameView &view, const RowSet &restrictions = {});
+
+    virtual float GetAttributeGiniIndex(const RowSet &restrictions = {});
+    virtual float GetAttributeGiniIndex(const DataFrameView &view, const RowSet &restrictions = {});
+
+    virtual std::vector<ProbabilityDistribution> *GetProbabilityDistribution(
+        const RowSet &restriction = {});
     virtual std::vector<ProbabilityDistribution> *GetProbabilityDistribution(
-        const std::vector<uint> &restriction = {});
+        const DataFrameView &view, const RowSet &restriction = {}, std::vector <uint> *codes = nullptr);
+
+    virtual uint GetCodes(const DataFrameView &view, std::vector <uint> &codes);
+    virtual bool GetSortedRows(const DataFrameView &view, std::vector <uint> &order);
 
     virtual Variant GetCell(uint index);
 };
 
-//------------------------------------------------------------------------| BoolVector
+//------------------------------------------------------------------------| Dictionary
 
-struct BoolAttribute: public Attribute
+struct Dictionary
+/*------------------------------------------------------------------------------
+desc | . interned string table, every distinct string is stored once.
+vars | order : codes sorted by the lexicographic order of their strings
+nots | . codes are given in order of appearance and never change.
+------------------------------------------------------------------------------*/
 {
 public :
 
-    std::vector <bool> cells;
+    std::vector <std::wstring> values;
+    std::vector <uint> order;
 
 public :
 
-    BoolAttribute(const std::wstring &name);
+    uint Size(void) const;
 
-public :
+    uint GetCode(const std::wstring &value);
+    uint FindCode(const std::wstring &value) const;
 
-    virtual uint Size(void);
-
-    virtual bool GetUniformity(void);
-    virtual Variant GetMode(const std::vector<uint> &indexes = {});
+    void Assign(std::vector <std::wstring> &values, std::vector <uint> &order);
 
-    virtual float GetAttributeEntropy(const std::vector<uint> &restrictions = {});
-    virtual float GetAttributeGiniIndex(const std::vector<uint> &restrictions = {});
+    const std::wstring &GetValue(uint code) const;
 
-    virtual std::vector<ProbabilityDistribution> *GetProbabilityDistribution(
-        const std::vector<uint> &restriction = {});
+private :
 
-    virtual Variant GetCell(uint index);
+    std::unordered_map <std::wstring, uint> codes;
 };
 
-//------------------------------------------------------------------------| IntAttribute
+//------------------------------------------------------------------------| ColumnCells
+
+template <class T> struct ColumnTraits;
+
+template <> struct ColumnTraits <bool> {enum {type = Variant::Bool, discrete = 1};};
+template <> struct ColumnTraits <int> {enum {type = Variant::Int, discrete = 0};};
+template <> struct ColumnTraits <float> {enum {type = Variant::Float, discrete = 0};};
+template <> struct ColumnTraits <std::wstring> {enum {type = Variant::WString, discrete = 1};};
+
+template <class T> struct ColumnCells
+/*------------------------------------------------------------------------------
+desc | . storage of the cells of a TypedColumn <T>.
+nots | . CopyDomain takes whatever besides the cells gives them meaning.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    Cells <T> cells;
+
+public :
 
-struct IntAttribute: public Attribute
+    void CopyDomain(const ColumnCells &/*source*/) {}
+};
+
+template <> struct ColumnCells <bool>
+/*------------------------------------------------------------------------------
+nots | . cells are bit packed, counts are popcounts of the cells and the rows.
+------------------------------------------------------------------------------*/
 {
 public :
 
-    std::vector <int> cells;
+    BitCells cells;
 
 public :
 
-    IntAttribute(const std::wstring &name);
+    void CopyDomain(const ColumnCells &/*source*/) {}
 
+    void GetCounts(const RowSet &rows, uint &falses, uint &trues) const;
+};
+
+template <> struct ColumnCells <std::wstring>
+/*------------------------------------------------------------------------------
+desc | . categorical cells, they hold codes of the dictionary.
+nots | . statistics work on codes, strings are only decoded at GetCell.
+------------------------------------------------------------------------------*/
+{
 public :
 
-    virtual uint Size(void);
+    Dictionary dictionary;
 
-    virtual bool GetUniformity(void);
-    virtual Variant GetMode(const std::vector<uint> &indexes = {});
+    Cells <uint> cells;
 
-    virtual float GetAttributeEntropy(const std::vector<uint> &restrictions = {});
-    virtual float GetAttributeGiniIndex(const std::vector<uint> &restrictions = {});
+public :
 
-    virtual std::vector<ProbabilityDistribution> *GetProbabilityDistribution(
-        const std::vector<uint> &restriction = {});
+    void CopyDomain(const ColumnCells &source) {dictionary = source.dictionary;}
 
-    virtual Variant GetCell(uint index);
+    void PushBack(const std::wstring &value);
+
+    const std::wstring &GetWString(uint index) const;
+    void SetWString(uint index, const std::wstring &value);
+
+    std::vector <int> GetFrecuency(const RowSet &rows) const;
 };
 
-//------------------------------------------------------------------------| FloaAttribute
+//------------------------------------------------------------------------| TypedColumn
 
-struct FloaAttribute: public Attribute
+template <class T> struct TypedColumn: public Attribute, public ColumnCells <T>
+/*------------------------------------------------------------------------------
+desc | . column of cells of type T, every attribute type is an instance of it.
+nots | . statistics are instantiated per cell type, a query costs one virtual call
+     |   and none per cell.
+     | . results are cached by the rows they were computed on, except
+     |   distributions asked for codes, which are per row anyway.
+     | . the generic members serve int and float, bool and std::wstring specialize
+     |   them over bit counts and dictionary codes.
+     | . a new cell type needs its ColumnTraits, its ColumnCells unless Cells <T>
+     |   will do, a case in Visit and an instantiation in core.cpp.
+------------------------------------------------------------------------------*/
 {
 public :
 
-    std::vector <float> cells;
+    using ColumnCells <T>::cells;
 
 public :
 
-    FloaAttribute(const std::wstring &name);
+    TypedColumn(const std::wstring &name);
 
 public :
 
     virtual uint Size(void);
 
     virtual bool GetUniformity(void);
-    virtual Variant GetMode(const std::vector<uint> &indexes = {});
+    virtual bool GetUniformity(const DataFrameView &view);
+
+    virtual Variant GetMode(const RowSet &indexes = {});
+    virtual Variant GetMode(const DataFrameView &view, const RowSet &indexes = {});
+
+    virtual float GetAttributeEntropy(const RowSet &restrictions = {});
+    virtual float GetAttributeEntropy(const DataFrameView &view, const RowSet &restrictions = {});
 
-    virtual float GetAttributeEntropy(const std::vector<uint> &restrictions = {});
-    virtual float GetAttributeGiniIndex(const std::vector<uint> &restrictions = {});
+    virtual float GetAttributeGiniIndex(const RowSet &restrictions = {});
+    virtual float GetAttributeGiniIndex(const DataFrameView &view, const RowSet &restrictions = {});
 
     virtual std::vector<ProbabilityDistribution> *GetProbabilityDistribution(
-        const std::vector<uint> &restriction = {});
+        const RowSet &restriction = {});
+    virtual std::vector<ProbabilityDistribution> *GetProbabilityDistribution(
+        const DataFrameView &view, const RowSet &restriction = {}, std::vector <uint> *codes = nullptr);
+
+    virtual uint GetCodes(const DataFrameView &view, std::vector <uint> &codes);
+    virtual bool GetSortedRows(const DataFrameView &view, std::vector <uint> &order);
 
     virtual Variant GetCell(uint index);
-};
 
-//------------------------------------------------------------------------| WStringAttribute
+private :
+
+    bool GetKey(const DataFrameView *view, const RowSet &restrictions, Cache::Key &key) const;
+
+    template <class V, class F> V GetCached(const DataFrameView *view, const RowSet &restrictions,
+        Cache::Field field, V Cache::Entry::*member, F compute);
+
+    bool GetCellUniformity(const DataFrameView *view);
+    Variant GetCellMode(const DataFrameView *view, const RowSet &restrictions);
+    float GetCellEntropy(const DataFrameView *view, const RowSet &restrictions);
+    float GetCellGiniIndex(const DataFrameView *view, const RowSet &restrictions);
 
-struct WStringAttribute: public Attribute
+    std::vector<ProbabilityDistribution> *GetCellDistribution(const DataFrameView *view,
+        const RowSet &restrictions, std::vector <uint> *codes = nullptr);
+};
+
+template <> uint TypedColumn<bool>::GetCodes(const DataFrameView &view, std::vector <uint> &codes);
+template <> bool TypedColumn<bool>::GetSortedRows(const DataFrameView &view, std::vector <uint> &order);
+template <> bool TypedColumn<bool>::GetCellUniformity(const DataFrameView *view);
+template <> Variant TypedColumn<bool>::GetCellMode(const DataFrameView *view, const RowSet &restrictions);
+template <> float TypedColumn<bool>::GetCellEntropy(const DataFrameView *view, const RowSet &restrictions);
+template <> float TypedColumn<bool>::GetCellGiniIndex(const DataFrameView *view, const RowSet &restrictions);
+template <> std::vector<Attribute::ProbabilityDistribution> *TypedColumn<bool>::GetCellDistribution(
+    const DataFrameView *view, const RowSet &restrictions, std::vector <uint> *codes);
+
+template <> uint TypedColumn<std::wstring>::GetCodes(const DataFrameView &view, std::vector <uint> &codes);
+template <> bool TypedColumn<std::wstring>::GetSortedRows(const DataFrameView &view, std::vector <uint> &order);
+template <> Variant TypedColumn<std::wstring>::GetCell(uint index);
+template <> Variant TypedColumn<std::wstring>::GetCellMode(const DataFrameView *view, const RowSet &restrictions);
+template <> float TypedColumn<std::wstring>::GetCellEntropy(const DataFrameView *view, const RowSet &restrictions);
+template <> float TypedColumn<std::wstring>::GetCellGiniIndex(const DataFrameView *view, const RowSet &restrictions);
+template <> std::vector<Attribute::ProbabilityDistribution> *TypedColumn<std::wstring>::GetCellDistribution(
+    const DataFrameView *view, const RowSet &restrictions, std::vector <uint> *codes);
+
+extern template struct TypedColumn <bool>;
+extern template struct TypedColumn <int>;
+extern template struct TypedColumn <float>;
+extern template struct TypedColumn <std::wstring>;
+
+typedef TypedColumn <bool> BoolAttribute;
+typedef TypedColumn <int> IntAttribute;
+typedef TypedColumn <float> FloaAttribute;
+typedef TypedColumn <std::wstring> WStringAttribute;
+
+template <class V> void Visit(Attribute *attribute, V &visitor)
+/*------------------------------------------------------------------------------
+desc | . calls visitor with the typed column behind attribute, found by its type.
+nots | . generic attributes are not visited.
+------------------------------------------------------------------------------*/
 {
-public :
+    switch(attribute->type)
+    {
+    case Variant::Bool : visitor(*static_cast<BoolAttribute *>(attribute)); break;
+    case Variant::Int : visitor(*static_cast<IntAttribute *>(attribute)); break;
+    case Variant::Float : visitor(*static_cast<FloaAttribute *>(attribute)); break;
+    case Variant::WString : visitor(*static_cast<WStringAttribute *>(attribute)); break;
+    default : break;
+    }
+}
 
-    std::vector <std::wstring> cells;
+//------------------------------------------------------------------------| Schema
 
+class Schema
+/*------------------------------------------------------------------------------
+desc | . hashed index from column names to column ids of a dataframe.
+nots | . rebuilt when the number of attributes changes or a hit no longer has
+     |   its name, the first column with a name wins, as in a linear scan.
+     | . may be queried concurrently, copies start with an empty index.
+------------------------------------------------------------------------------*/
+{
 public :
 
-    WStringAttribute(const std::wstring &name);
+    Schema(void);
+    Schema(const Schema &rhs);
 
-public :
+    Schema &operator=(const Schema &rhs);
 
-    virtual uint Size(void);
+    uint Find(const std::vector <Attribute *> &attributes, const std::wstring &name) const;
 
-    virtual bool GetUniformity(void);
-    virtual Variant GetMode(const std::vector<uint> &indexes = {});
+private :
 
-    virtual float GetAttributeEntropy(const std::vector<uint> &restrictions = {});
-    virtual float GetAttributeGiniIndex(const std::vector<uint> &restrictions = {});
+    mutable std::mutex mutex;
+    mutable std::unordered_map <std::wstring, uint> index;
+    mutable uint size;
 
-    virtual std::vector<ProbabilityDistribution> *GetProbabilityDistribution(const std::vector<uint> &restriction = {});
+private :
 
-    virtual Variant GetCell(uint index);
+    void Build(const std::vector <Attribute *> &attributes) const;
 };
 
 //------------------------------------------------------------------------| DataFrame
@@ -493,6 +869,7 @@ public :
 struct DataFrame
 /*------------------------------------------------------------------------------
 nots | . vector requires pointer of Vectors to avoid object slicing
+     | . AttributeType shares the values of Variant::Type.
 ------------------------------------------------------------------------------*/
 {
 public :
@@ -503,6 +880,8 @@ public :
 
     std::vector <Attribute *> attributes;
 
+    Schema schema;
+
 public :
 
     DataFrame(void);
@@ -510,8 +889,9 @@ public :
     uint Size(void);
     void Clear(void);
 
-    ubyte GetColumnByAttribute(const std::wstring &attribute);
-    ubyte GetColumnType(ubyte index);
+    uint GetColumnByAttribute(const std::wstring &attribute);
+    uint GetColumnByAttribute(const std::wstring &attribute, uint column);
+    ubyte GetColumnType(uint index);
 
     DataFrame *GetSubDataFrame(const std::vector <uint> &indexes);
 };
@@ -519,6 +899,11 @@ public :
 //------------------------------------------------------------------------| Common
 
 bool Validate(Variant &a, MathOp &mathop, Variant &b);
+
+void EncodeUTF8(const std::wstring &wstring, std::string &string);
+bool DecodeUTF8(const unsigned char *string, uint64_t size, std::wstring &wstring);
+
+FILE *OpenFile(const std::wstring &path, const wchar_t *mode);
 }
 
 #endif // CORE_H
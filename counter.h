@@ -0,0 +1,314 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#ifndef COUNTER_H
+#define COUNTER_H
+
+#include <vector>
+#include <utility>
+#include <limits>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+
+#include "rowset.h"
+
+namespace ML
+{
+//------------------------------------------------------------------------| CounterKey
+
+template <class K> struct CounterKey
+/*------------------------------------------------------------------------------
+desc | . how a key is counted, integral keys may use a direct-indexed array.
+------------------------------------------------------------------------------*/
+{
+    static const bool integral = false;
+
+    static int64_t GetIndex(const K &/*key*/) {return(0);}
+    static uint64_t GetHash(const K &key) {return((uint64_t)(key));}
+};
+
+template <> struct CounterKey <bool>
+{
+    static const bool integral = true;
+
+    static int64_t GetIndex(const bool &key) {return(key ? 1 : 0);}
+    static uint64_t GetHash(const bool &key) {return(key ? 1 : 0);}
+};
+
+template <> struct CounterKey <int>
+{
+    static const bool integral = true;
+
+    static int64_t GetIndex(const int &key) {return(key);}
+    static uint64_t GetHash(const int &key) {return((uint64_t)(uint)(key));}
+};
+
+template <> struct CounterKey <uint>
+{
+    static const bool integral = true;
+
+    static int64_t GetIndex(const uint &key) {return(key);}
+    static uint64_t GetHash(const uint &key) {return(key);}
+};
+
+template <> struct CounterKey <float>
+/*------------------------------------------------------------------------------
+nots | . -0.0f and 0.0f are the same key, as they are for std::map.
+     | . every NaN is the same key, counted in one bucket sorted after numbers.
+------------------------------------------------------------------------------*/
+{
+    static const bool integral = false;
+
+    static int64_t GetIndex(const float &/*key*/) {return(0);}
+
+    static uint64_t GetHash(const float &key)
+    {
+        if(key != key) return(0x7fc00000);
+
+        float value = (key == 0.0f) ? 0.0f : key;
+        uint32_t bits;
+
+        memcpy(&bits, &value, sizeof(bits));
+
+        return(bits);
+    }
+};
+
+template <class K> inline bool KeyEqual(const K &lhs, const K &rhs) {return(lhs == rhs);}
+template <class K> inline bool KeyLess(const K &lhs, const K &rhs) {return(lhs < rhs);}
+
+inline bool KeyEqual(const float &lhs, const float &rhs)
+{
+    return((lhs == rhs) || ((lhs != lhs) && (rhs != rhs)));
+}
+
+inline bool KeyLess(const float &lhs, const float &rhs)
+{
+    return((lhs == lhs) && ((rhs != rhs) || (lhs < rhs)));
+}
+
+//------------------------------------------------------------------------| FrecuencyCounter
+
+template <class K> class FrecuencyCounter
+/*------------------------------------------------------------------------------
+desc | . counts the values of the selected cells, visited in key order.
+nots | . integral keys whose range is at most max(1024, 2 * rows) use a
+     |   direct-indexed array, any other key an open-addressing hash table.
+     | . once counted, every key knows its position in GetFrecuency().
+------------------------------------------------------------------------------*/
+{
+public :
+
+    template <class C> FrecuencyCounter(const C &cells, const RowSet &rows) : dense(false), minimum(0), mask(0)
+    {
+        uint range = 0;
+
+        if(CounterKey<K>::integral && GetDomain(cells, rows, range))
+            CountDense(cells, rows, range);
+        else
+            CountHash(cells, rows);
+    }
+
+    const std::vector <std::pair <K, int> > &GetFrecuency(void) const {return(frecuency);}
+
+    uint Size(void) const {return(frecuency.size());}
+
+    uint GetPosition(const K &key) const
+    {
+        if(dense) return(positions[CounterKey<K>::GetIndex(key) - minimum]);
+
+        for(uint slot = GetSlot(key); counts[slot]; slot = (slot + 1) & mask)
+        {
+            if(KeyEqual(keys[slot], key)) return(positions[slot]);
+        }
+
+        return(0);
+    }
+
+    int GetMaximum(void) const
+    /*--------------------------------------------------------------------------
+    nots | . position of the first key with maximum count, as FrecuencyMax.
+    --------------------------------------------------------------------------*/
+    {
+        int index = -1;
+        int maximum = -std::numeric_limits<int>::max();
+
+        for(uint i = 0, n = frecuency.size(); i < n; ++i)
+        {
+            if(frecuency[i].second > maximum)
+            {
+                index = i;
+                maximum = frecuency[i].second;
+            }
+        }
+
+        return(index);
+    }
+
+private :
+
+    bool dense;
+
+    int64_t minimum;
+    uint mask;
+
+    std::vector <K> keys;
+    std::vector <int> counts;
+    std::vector <uint> positions;
+
+    std::vector <std::pair <K, int> > frecuency;
+
+private :
+
+    template <class C> bool GetDomain(const C &cells, const RowSet &rows, uint &range)
+    {
+        if(rows.IsEmpty()) return(false);
+
+        int64_t maximum = CounterKey<K>::GetIndex(cells[*rows.begin()]);
+
+        minimum = maximum;
+
+        for(uint i : rows)
+        {
+            int64_t index = CounterKey<K>::GetIndex(cells[i]);
+
+            if(index < minimum) minimum = index;
+            if(index > maximum) maximum = index;
+        }
+
+        uint64_t domain = (uint64_t)(maximum - minimum) + 1;
+        uint64_t limit = 2 * (uint64_t)(rows.Size());
+
+        range = (uint)(domain);
+
+        return(domain <= ((limit > 1024) ? limit : 1024));
+    }
+
+    template <class C> void CountDense(const C &cells, const RowSet &rows, uint range)
+    {
+        std::vector <int> histogram(range, 0);
+
+        for(uint i : rows)
+            ++histogram[CounterKey<K>::GetIndex(cells[i]) - minimum];
+
+        dense = true;
+        positions.assign(histogram.size(), 0);
+
+        for(uint index = 0, n = histogram.size(); index < n; ++index)
+        {
+            if(!histogram[index]) continue;
+
+            positions[index] = frecuency.size();
+            frecuency.push_back(std::pair <K, int>((K)(index + minimum), histogram[index]));
+        }
+    }
+
+    template <class C> void CountHash(const C &cells, const RowSet &rows)
+    {
+        Resize(64);
+
+        uint size = 0;
+
+        for(uint i : rows)
+        {
+            K key = cells[i];
+
+            uint slot = GetSlot(key);
+
+            for(; counts[slot] && !KeyEqual(keys[slot], key); slot = (slot + 1) & mask);
+
+            if(!counts[slot])
+            {
+                keys[slot] = key;
+                ++size;
+            }
+
+            ++counts[slot];
+
+            if(2 * size > mask) Resize(2 * (mask + 1));
+        }
+
+        for(uint slot = 0; slot <= mask; ++slot)
+        {
+            if(counts[slot])
+                frecuency.push_back(std::pair <K, int>(keys[slot], counts[slot]));
+        }
+
+        std::sort(frecuency.begin(), frecuency.end(), CompareKey);
+
+        positions.assign(mask + 1, 0);
+
+        for(uint i = 0, n = frecuency.size(); i < n; ++i)
+        {
+            uint slot = GetSlot(frecuency[i].first);
+
+            for(; !KeyEqual(keys[slot], frecuency[i].first); slot = (slot + 1) & mask);
+
+            positions[slot] = i;
+        }
+    }
+
+    uint GetSlot(const K &key) const
+    {
+        return((uint)((CounterKey<K>::GetHash(key) * 0x9E3779B97F4A7C15ull) >> 32) & mask);
+    }
+
+    void Resize(uint capacity)
+    {
+        std::vector <K> oldKeys(capacity);
+        std::vector <int> oldCounts(capacity, 0);
+
+        oldKeys.swap(keys);
+        oldCounts.swap(counts);
+
+        mask = capacity - 1;
+
+        for(uint slot = 0, n = oldCounts.size(); slot < n; ++slot)
+        {
+            if(!oldCounts[slot]) continue;
+
+            uint target = GetSlot(oldKeys[slot]);
+
+            for(; counts[target]; target = (target + 1) & mask);
+
+            keys[target] = oldKeys[slot];
+            counts[target] = oldCounts[slot];
+        }
+    }
+
+    static bool CompareKey(const std::pair <K, int> &lhs, const std::pair <K, int> &rhs)
+    {
+        return(KeyLess(lhs.first, rhs.first));
+    }
+};
+
+//------------------------------------------------------------------------| Median
+
+template <class T> typename std::vector<T>::const_iterator FrecuencyMedian(const std::vector <T> &sorted,
+    uint N, uint &f)
+/*------------------------------------------------------------------------------
+desc | . sort based counterpart of FrecuencyMedian over sorted values.
+nots | . walks runs of equal values exactly as the map version walks its keys.
+     | . if the runs end before reaching N / 2 the last run is returned.
+------------------------------------------------------------------------------*/
+{
+    auto it = sorted.begin();
+
+    for(f = 0; (it != sorted.end()) && (f < (N / 2));)
+    {
+        auto next = std::upper_bound(it, sorted.end(), *it);
+
+        if(next == sorted.end()) break;
+
+        it = next;
+
+        f += std::upper_bound(it, sorted.end(), *it) - it;
+    }
+
+    return(it);
+}
+}
+
+#endif // COUNTER_H
@@ -23,23 +23,40 @@ int DecisionTree::GetArgumentIndex(const std::wstring &value, uint index)
     }
 }
 
-DecisionTree::DecisionTree(ubyte attributeSelection) : Tree(), attributeSelection(attributeSelection) {}
+DecisionTree::DecisionTree(ubyte attributeSelection) : Tree(), attributeSelection(attributeSelection), bins(0) {}
 
 void DecisionTree::Train(const DataFrame *dataframe)
 {
     if(!dataframe) dataframe = &samples;
 
-    DataFrame subsamples = *dataframe;
+    DataFrameView subsamples(const_cast<DataFrame *>(dataframe));
 
-    std::vector <std::wstring> subattributes;
+    Train(subsamples);
+}
+
+void DecisionTree::Train(DataFrameView &subsamples)
+/*------------------------------------------------------------------------------
+nots | . subsamples are presorted if they carry no orders yet.
+------------------------------------------------------------------------------*/
+{
+    if(subsamples.orders.empty()) subsamples.Presort();
+
+    std::vector <uint> subcolumns;
+
+    for(uint i = 0, n = subsamples.dataframe->attributes.size() - 1; i < n; ++i)
+        subcolumns.push_back(i);
 
-    for(uint i = 0, n = dataframe->attributes.size() - 1; i < n; ++i)
-        subattributes.push_back(dataframe->attributes[i]->name);
+    Clear();
 
-    clrptrvector<Node *>(nodes);
-    clrptrvector<Edge *>(edges);
+    if(bins) binning.Build(subsamples, bins);
 
-    TreeInduction(subsamples, subattributes);
+    Fragment fragment;
+
+    TreeInduction(subsamples, subcolumns, fragment);
+
+    Append(fragment);
+
+    binning.Clear();
 
     RankHierarchy();
 }
@@ -57,7 +74,8 @@ void DecisionTree::KCrossValidation(uint k)
     {
         WStringAttribute *wstringAttribute = new WStringAttribute((*probabilityDistribution)[i].value.ToWString());
 
-        wstringAttribute->cells.insert(wstringAttribute->cells.begin(), n, L"0:0");
+        for(uint j = 0; j < n; ++j)
+            wstringAttribute->PushBack(L"0:0");
 
         confusionMatrix.attributes.push_back(wstringAttribute);
     }
@@ -82,28 +100,44 @@ void DecisionTree::KCrossValidation(uint k)
                 trainingIndexes.push_back(j);
         }
 
-        DataFrame *training = samples.GetSubDataFrame(trainingIndexes);
-        DataFrame *validation = samples.GetSubDataFrame(validationIndexes);
+        DataFrameView training(&samples, trainingIndexes);
+        DataFrameView validation(&samples, validationIndexes);
 
         Train(training);
 
-        for(uint j = 0, m = validation->Size(); j < m; ++j)
+        std::vector <uint> leaves(validation.Size());
+
+        bool batch = PredictBatch(validation, leaves.data());
+
+        uint j = 0;
+
+        for(uint row : validation.rows)
         {
             int positives, instances;
 
-            DataFrame *sample = validation->GetSubDataFrame({j});
+            ML::Node *node = nullptr;
 
-            ML::Node *node = Predict(*sample);
+            if(batch)
+                node = compiled.sources[leaves[j++]];
+            else
+            {
+                DataFrame *sample = samples.GetSubDataFrame({row});
 
-            int real = GetConfusionIndex(sample->attributes.back()->GetCell(0).ToWString());
+                node = Predict(*sample);
+
+                sample->Clear();
+                delete(sample);
+            }
 
-            positives = GetArgumentIndex(static_cast<WStringAttribute *>(confusionMatrix.attributes[real])->cells[real], 0);
-            instances = GetArgumentIndex(static_cast<WStringAttribute *>(confusionMatrix.attributes[real])->cells[real], 1);
+            int real = GetConfusionIndex(samples.attributes.back()->GetCell(row).ToWString());
+
+            positives = GetArgumentIndex(static_cast<WStringAttribute *>(confusionMatrix.attributes[real])->GetWString(real), 0);
+            instances = GetArgumentIndex(static_cast<WStringAttribute *>(confusionMatrix.attributes[real])->GetWString(real), 1);
 
             ++instances;
 
-            static_cast<WStringAttribute *>(confusionMatrix.attributes[real])->cells[real] = std::to_wstring(positives) +
-                L":" + std::to_wstring(instances);
+            static_cast<WStringAttribute *>(confusionMatrix.attributes[real])->SetWString(real, std::to_wstring(positives) +
+                L":" + std::to_wstring(instances));
 
             if(node->leaf)
             {
@@ -111,13 +145,13 @@ void DecisionTree::KCrossValidation(uint k)
 
                 int classified = GetConfusionIndex(node->data.ToWString());
 
-                positives = GetArgumentIndex(static_cast<WStringAttribute *>(confusionMatrix.attributes[classified])->cells[real], 0);
-                instances = GetArgumentIndex(static_cast<WStringAttribute *>(confusionMatrix.attributes[classified])->cells[real], 1);
+                positives = GetArgumentIndex(static_cast<WStringAttribute *>(confusionMatrix.attributes[classified])->GetWString(real), 0);
+                instances = GetArgumentIndex(static_cast<WStringAttribute *>(confusionMatrix.attributes[classified])->GetWString(real), 1);
 
                 ++positives;
 
-                static_cast<WStringAttribute *>(confusionMatrix.attributes[classified])->cells[real] = std::to_wstring(positives) +
-                    L":" + std::to_wstring(instances);
+                static_cast<WStringAttribute *>(confusionMatrix.attributes[classified])->SetWString(real, std::to_wstring(positives) +
+                    L":" + std::to_wstring(instances));
             }
         }
     }
@@ -131,93 +165,158 @@ void DecisionTree::KCrossValidation(uint k)
         FloaAttribute *floatAttribute = static_cast<FloaAttribute *>(confusionMatrix.attributes[i]);
 
         for(uint j = 0, m = floatAttribute->Size();  j < m; ++j)
-            floatAttribute->cells[j] /= (float)(k);
+            floatAttribute->cells.Set(j, floatAttribute->cells[j] / (float)(k));
     }
 }
 
-ML::Node *DecisionTree::TreeInduction(DataFrame &subsamples, std::vector<std::wstring> &subattributes)
+ML::Node *DecisionTree::TreeInduction(DataFrameView &subsamples, std::vector<uint> subcolumns,
+    Fragment &fragment, uint deep, Histogram *histogram)
 /*------------------------------------------------------------------------------
 vars | maxdeep : used for debugging.
+     | mintask : minimum rows for a subtree to be induced as a pool task.
+     | deep : depth of the node, 1 at the root.
+     | histogram : counts of the node when binning, divided from its parent's.
 nots | . assuming last factor is class
+     | . subcolumns are the ids of the attributes not yet in the path, every
+     |   path removes its own selected attributes, siblings do not share them.
+     | . large subtrees are pool tasks, the rest are built meanwhile. Subtrees
+     |   before the first pool task are built in the fragment of their parent,
+     |   the others in a fragment of their own, appended in edge order.
 ------------------------------------------------------------------------------*/
 {
-    const int maxdeep = 0;
-
-    static int deep = 0;
-
-    ++deep;
+    const uint maxdeep = 0;
+    const uint mintask = 256;
 
     // '--> P1 : Create node.
 
-    Node *node = AddNode();
+    Node *node = fragment.AddNode();
 
     // '--> P2 : If all the subsamples belongs to same class, then return node as leaf node of class C.
-    // '--> P3 : If subattributes is empty then return node as leaf node.
+    // '--> P3 : If subcolumns is empty then return node as leaf node.
 
-    bool uniformity = subsamples.attributes.back()->GetUniformity();
+    Attribute *target = subsamples.dataframe->attributes.back();
 
-    if(uniformity || subattributes.empty())
+    bool uniformity = target->GetUniformity(subsamples);
+
+    if(uniformity || subcolumns.empty())
     {
-        node->data = subsamples.attributes.back()->GetMode();
+        node->data = target->GetMode(subsamples);
         node->leaf = true;
 
-        --deep;
         return(node);
     }
 
     // '--> P4 : Select the attribute that best divides the subsamples dataframe.
 
-    std::wstring attribute;
+    Histogram root(&binning);
+
+    if(!histogram && binning.IsBuilt())
+    {
+        root.Accumulate(subsamples, subcolumns);
+
+        histogram = &root;
+    }
+
+    AttributeSelection::Split split;
 
-    switch(attributeSelection)
+    uint column = AttributeSelection::SelectColumn(subsamples, subcolumns, attributeSelection, 1, pool,
+                                                   histogram, &split);
+
+    if(column == (uint)-1)
     {
-    case 0 : attribute = AttributeSelection::InformationGain(subsamples, subattributes); break;
-    case 1 : attribute = AttributeSelection::GiniImpurity(subsamples, subattributes); break;
-    case 2 : attribute = AttributeSelection::ProportionGain(subsamples, subattributes); break;
+        node->data = target->GetMode(subsamples);
+        node->leaf = true;
+
+        return(node);
     }
 
     // '--> P5 : Clear attribute selected from attribute list.
 
-    ClearAttribute(attribute, subattributes);
+    ClearColumn(column, subcolumns);
 
     // '--> P6 : Label node with selected atributte.
 
-    node->data = attribute;
+    Attribute *factor = subsamples.dataframe->attributes[column];
+
+    node->data = factor->name;
+    node->column = column;
 
     // '--> P7 : For every value of attribute (being subsubsample the set of elements with value V in attribute A).
     // '--> P8 : If subsubsample is empty then create an edge with mode class.
     // '--> P9 : Else create an edge than bind node to node returned frome TreeInduction(subsubdataframe, subsubattributes)
 
-    Attribute *factor = subsamples.attributes[subsamples.GetColumnByAttribute(attribute)];
+    std::unique_ptr<std::vector<ML::Attribute::ProbabilityDistribution>> probabilityDistribution(
+        (split.boundary != (uint)-1) ? binning.GetProbabilityDistribution(subsamples, column, split.boundary) :
+                                       factor->GetProbabilityDistribution(subsamples));
+
+    uint n = (*probabilityDistribution).size();
+
+    std::vector <const RowSet *> parts;
 
-    std::vector<ML::Attribute::ProbabilityDistribution> *probabilityDistribution = factor->GetProbabilityDistribution();
+    for(uint i = 0; i < n; ++i)
+        parts.push_back(&(*probabilityDistribution)[i].indexes);
 
-    for(uint i = 0, n = (*probabilityDistribution).size(); i < n; ++i)
+    std::vector <DataFrameView> subviews = subsamples.Partition(parts);
+
+    std::vector <Histogram> histograms;
+
+    if(histogram) histograms = histogram->Divide(subviews, subcolumns);
+
+    auto induction = [this, &subsamples, &subviews, &subcolumns, &histograms, &probabilityDistribution,
+                      target, node, deep](uint i, Fragment &fragment)
     {
+        const Attribute::ProbabilityDistribution &distribution = (*probabilityDistribution)[i];
+
         Node *child = nullptr;
 
-        if((*probabilityDistribution)[i].indexes.empty())
+        if(distribution.indexes.IsEmpty())
         {
-            child = AddNode();
+            child = fragment.AddNode();
 
             child->leaf = true;
-            child->data = subsamples.attributes.back()->GetMode();
+            child->data = target->GetMode(subsamples);
         }
         else
         {
             if((maxdeep == 0) || (deep < maxdeep))
-            {
-                child = TreeInduction(*subsamples.GetSubDataFrame((*probabilityDistribution)[i].indexes), subattributes);
-            }
+                child = TreeInduction(subviews[i], subcolumns, fragment, deep + 1,
+                                      histograms.empty() ? nullptr : &histograms[i]);
         }
 
-        if(child) AddEdge((*probabilityDistribution)[i].value, (*probabilityDistribution)[i].p,
-                          (*probabilityDistribution)[i].mathop, node, child);
+        if(child) fragment.AddEdge(distribution.value, distribution.p, distribution.mathop, node, child);
+    };
+
+    std::vector <Fragment> fragments(pool ? n : 0);
+    std::vector <bool> tasks(n, false);
+
+    uint first = n;
+
+    // '--> Large subtrees are pool tasks, built in their own fragment.
+
+    TaskGroup group(pool);
+
+    for(uint i = 0; (i < n) && pool; ++i)
+    {
+        if((*probabilityDistribution)[i].indexes.Size() < mintask) continue;
+
+        tasks[i] = true;
+        first = std::min(first, i);
+
+        group.Run([&induction, &fragments, i](void) {induction(i, fragments[i]);});
+    }
+
+    // '--> The rest are built meanwhile, in place before the first task.
+
+    for(uint i = 0; i < n; ++i)
+    {
+        if(!tasks[i]) induction(i, (i < first) ? fragment : fragments[i]);
     }
 
-    delete(probabilityDistribution);
+    group.Wait();
+
+    for(uint i = first; i < n; ++i)
+        fragment.Append(fragments[i]);
 
-    --deep;
     return(node);
 }
 
@@ -16,6 +16,9 @@ namespace ML
 class DecisionTree : public Tree
 /*------------------------------------------------------------------------------
 vars | attributeSelection | 0 : Information Gain | 1 : Gini Impurity | 2 : Proportion Gain
+     | bins | 0 : continuous attributes split at their median | 2 .. 256 : continuous
+     |   attributes binned, split at their best bin boundary
+     | binning : bins of the dataframe being trained, cleared after training
 ------------------------------------------------------------------------------*/
 {
 public :
@@ -24,6 +27,10 @@ public :
 
     ubyte attributeSelection;
 
+    uint bins;
+
+    Binning binning;
+
 public :
 
     static int GetArgumentIndex(const std::wstring &value, uint index);
@@ -33,11 +40,13 @@ public :
     DecisionTree(ubyte attributeSelection = 0);
 
     void Train(const DataFrame *dataframe = nullptr);
+    void Train(DataFrameView &subsamples);
     void KCrossValidation(uint k);  
 
 private :
 
-    Node *TreeInduction(DataFrame &subsamples, std::vector <std::wstring> &subattributes);
+    Node *TreeInduction(DataFrameView &subsamples, std::vector <uint> subcolumns,
+        Fragment &fragment, uint deep = 1, Histogram *histogram = nullptr);
 
     int GetConfusionIndex(const std::wstring &value);    
 };
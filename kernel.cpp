@@ -0,0 +1,800 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#include <cmath>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+#include "kernel.h"
+#include "rowset.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNEL_X86
+#define KERNEL_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define KERNEL_X86
+#define KERNEL_TARGET(isa)
+#include <intrin.h>
+#endif
+
+#if defined(KERNEL_X86)
+#include <immintrin.h>
+#endif
+
+using namespace ML;
+
+//------------------------------------------------------------------------| Global
+
+static const uint block = 256;
+
+typedef void (*IndexFunction)(const uint *values, const uint *classes, uint n, uint K, uint *index);
+typedef void (*ProportionFunction)(const int *counts, uint n, float N, float *p);
+typedef uint (*BitmapFunction)(const uint64_t *lhs, const uint64_t *rhs, uint n, uint64_t *words, bool complement);
+typedef float (*ReduceFunction)(const int *counts, uint n, float N);
+
+static std::atomic<int> detected(-1);
+static std::atomic<int> current(-1);
+
+static std::atomic<bool> fused(false);
+
+static Kernel::Level Detect(void)
+/*------------------------------------------------------------------------------
+nots | . wide levels also need the OS to save their registers.
+------------------------------------------------------------------------------*/
+{
+#if defined(KERNEL_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+
+    if(__builtin_cpu_supports("avx512f")) return(Kernel::AVX512);
+    if(__builtin_cpu_supports("avx2")) return(Kernel::AVX2);
+    if(__builtin_cpu_supports("sse4.2")) return(Kernel::SSE42);
+#elif defined(KERNEL_X86)
+    int info[4];
+
+    __cpuid(info, 0);
+
+    int ids = info[0];
+
+    __cpuid(info, 1);
+
+    bool sse42 = (info[2] >> 20) & 1;
+    bool osxsave = (info[2] >> 27) & 1;
+
+    uint64_t xcr0 = osxsave ? _xgetbv(0) : 0;
+
+    bool avx2 = false;
+    bool avx512 = false;
+
+    if(ids >= 7)
+    {
+        __cpuidex(info, 7, 0);
+
+        avx2 = ((info[1] >> 5) & 1) && ((xcr0 & 0x06) == 0x06);
+        avx512 = ((info[1] >> 16) & 1) && ((xcr0 & 0xe6) == 0xe6);
+    }
+
+    if(avx512) return(Kernel::AVX512);
+    if(avx2) return(Kernel::AVX2);
+    if(sse42) return(Kernel::SSE42);
+#endif
+
+    return(Kernel::Scalar);
+}
+
+//------------------------------------------------------------------------| Scalar
+
+static void IndexScalar(const uint *values, const uint *classes, uint n, uint K, uint *index)
+{
+    for(uint i = 0; i < n; ++i)
+        index[i] = values[i] * K + classes[i];
+}
+
+static void ProportionScalar(const int *counts, uint n, float N, float *p)
+{
+    for(uint i = 0; i < n; ++i)
+        p[i] = (float)(counts[i])/N;
+}
+
+static float EntropyScalar(const int *counts, uint n, float N)
+{
+    float entropy = 0.0f;
+
+    for(uint i = 0; i < n; ++i)
+    {
+        if(!counts[i]) continue;
+
+        float p = (float)(counts[i])/N;
+
+        entropy -= (p * log2(p));
+    }
+
+    return(entropy);
+}
+
+static float SquaresScalar(const int *counts, uint n, float N)
+{
+    float squares = 0.0f;
+
+    for(uint i = 0; i < n; ++i)
+    {
+        float p = (float)(counts[i])/N;
+
+        squares += (p * p);
+    }
+
+    return(squares);
+}
+
+static uint BitmapScalar(const uint64_t *lhs, const uint64_t *rhs, uint n, uint64_t *words, bool complement)
+{
+    uint total = 0;
+
+    for(uint i = 0; i < n; ++i)
+    {
+        uint64_t word = lhs[i] & (complement ? ~rhs[i] : rhs[i]);
+
+        if(words) words[i] = word;
+
+        total += popcount64(word);
+    }
+
+    return(total);
+}
+
+#if defined(KERNEL_X86)
+
+//------------------------------------------------------------------------| SSE42
+
+KERNEL_TARGET("sse4.2") static void IndexSSE42(const uint *values, const uint *classes, uint n, uint K, uint *index)
+{
+    __m128i k = _mm_set1_epi32((int)(K));
+
+    uint i = 0;
+
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(classes + i));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(index + i), _mm_add_epi32(_mm_mullo_epi32(v, k), c));
+    }
+
+    IndexScalar(values + i, classes + i, n - i, K, index + i);
+}
+
+KERNEL_TARGET("sse4.2") static void ProportionSSE42(const int *counts, uint n, float N, float *p)
+{
+    __m128 d = _mm_set1_ps(N);
+
+    uint i = 0;
+
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(counts + i));
+
+        _mm_storeu_ps(p + i, _mm_div_ps(_mm_cvtepi32_ps(c), d));
+    }
+
+    ProportionScalar(counts + i, n - i, N, p + i);
+}
+
+KERNEL_TARGET("sse4.2") static inline __m128 Log2SSE42(__m128 x)
+/*------------------------------------------------------------------------------
+desc | . log2 of positive normal floats, the logf polynomial of Cephes.
+nots | . x = m * 2^e with m in [sqrt(0.5), sqrt(2)), ln(m) is a polynomial of
+     |   m - 1, within a few ulp of the library log2.
+------------------------------------------------------------------------------*/
+{
+    __m128i bits = _mm_castps_si128(x);
+    __m128 one = _mm_set1_ps(1.0f);
+
+    __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+                                             _mm_set1_epi32(0x3f000000)));
+
+    __m128 low = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+
+    e = _mm_sub_ps(e, _mm_and_ps(low, one));
+    m = _mm_sub_ps(_mm_add_ps(m, _mm_and_ps(low, m)), one);
+
+    __m128 z = _mm_mul_ps(m, m);
+    __m128 y = _mm_set1_ps(7.0376836292e-2f);
+
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.1514610310e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.1676998740e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.2420140846e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.4249322787e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.6668057665e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(2.0000714765e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-2.4999993993e-1f));
+    y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(3.3333331174e-1f));
+    y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+
+    y = _mm_sub_ps(y, _mm_mul_ps(_mm_set1_ps(0.5f), z));
+
+    __m128 ln = _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(0.693147180559945309f)));
+
+    return(_mm_mul_ps(ln, _mm_set1_ps(1.44269504088896341f)));
+}
+
+KERNEL_TARGET("sse4.2") static float EntropySSE42(const int *counts, uint n, float N)
+/*------------------------------------------------------------------------------
+nots | . empty classes take the log2 of 1 and add 0.
+------------------------------------------------------------------------------*/
+{
+    __m128 d = _mm_set1_ps(N);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 sum = _mm_setzero_ps();
+
+    uint i = 0;
+
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(counts + i));
+        __m128 p = _mm_div_ps(_mm_cvtepi32_ps(c), d);
+        __m128 empty = _mm_castsi128_ps(_mm_cmpeq_epi32(c, _mm_setzero_si128()));
+
+        sum = _mm_add_ps(sum, _mm_mul_ps(p, Log2SSE42(_mm_blendv_ps(p, one, empty))));
+    }
+
+    float lanes[4];
+
+    _mm_storeu_ps(lanes, sum);
+
+    return(EntropyScalar(counts + i, n - i, N) - ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])));
+}
+
+KERNEL_TARGET("sse4.2") static float SquaresSSE42(const int *counts, uint n, float N)
+{
+    __m128 d = _mm_set1_ps(N);
+    __m128 sum = _mm_setzero_ps();
+
+    uint i = 0;
+
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(counts + i));
+        __m128 p = _mm_div_ps(_mm_cvtepi32_ps(c), d);
+
+        sum = _mm_add_ps(sum, _mm_mul_ps(p, p));
+    }
+
+    float lanes[4];
+
+    _mm_storeu_ps(lanes, sum);
+
+    return(SquaresScalar(counts + i, n - i, N) + ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])));
+}
+
+KERNEL_TARGET("sse4.2,popcnt") static uint BitmapSSE42(const uint64_t *lhs, const uint64_t *rhs, uint n,
+    uint64_t *words, bool complement)
+{
+    uint total = 0;
+
+    for(uint i = 0; i < n; ++i)
+    {
+        uint64_t word = lhs[i] & (complement ? ~rhs[i] : rhs[i]);
+
+        if(words) words[i] = word;
+
+#if defined(__x86_64__) || defined(_M_X64)
+        total += (uint)(_mm_popcnt_u64(word));
+#else
+        total += (uint)(_mm_popcnt_u32((unsigned int)(word)) + _mm_popcnt_u32((unsigned int)(word >> 32)));
+#endif
+    }
+
+    return(total);
+}
+
+//------------------------------------------------------------------------| AVX2
+
+KERNEL_TARGET("avx2") static void IndexAVX2(const uint *values, const uint *classes, uint n, uint K, uint *index)
+{
+    __m256i k = _mm256_set1_epi32((int)(K));
+
+    uint i = 0;
+
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(classes + i));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(index + i), _mm256_add_epi32(_mm256_mullo_epi32(v, k), c));
+    }
+
+    IndexScalar(values + i, classes + i, n - i, K, index + i);
+}
+
+KERNEL_TARGET("avx2") static void ProportionAVX2(const int *counts, uint n, float N, float *p)
+{
+    __m256 d = _mm256_set1_ps(N);
+
+    uint i = 0;
+
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(counts + i));
+
+        _mm256_storeu_ps(p + i, _mm256_div_ps(_mm256_cvtepi32_ps(c), d));
+    }
+
+    ProportionScalar(counts + i, n - i, N, p + i);
+}
+
+KERNEL_TARGET("avx2") static inline __m256 Log2AVX2(__m256 x)
+/*------------------------------------------------------------------------------
+nots | . as Log2SSE42, eight lanes at a time.
+------------------------------------------------------------------------------*/
+{
+    __m256i bits = _mm256_castps_si256(x);
+    __m256 one = _mm256_set1_ps(1.0f);
+
+    __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+    __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+                                                   _mm256_set1_epi32(0x3f000000)));
+
+    __m256 low = _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+
+    e = _mm256_sub_ps(e, _mm256_and_ps(low, one));
+    m = _mm256_sub_ps(_mm256_add_ps(m, _mm256_and_ps(low, m)), one);
+
+    __m256 z = _mm256_mul_ps(m, m);
+    __m256 y = _mm256_set1_ps(7.0376836292e-2f);
+
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(-1.1514610310e-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(1.1676998740e-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(-1.2420140846e-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(1.4249322787e-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(-1.6668057665e-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(2.0000714765e-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(-2.4999993993e-1f));
+    y = _mm256_add_ps(_mm256_mul_ps(y, m), _mm256_set1_ps(3.3333331174e-1f));
+    y = _mm256_mul_ps(_mm256_mul_ps(y, m), z);
+
+    y = _mm256_sub_ps(y, _mm256_mul_ps(_mm256_set1_ps(0.5f), z));
+
+    __m256 ln = _mm256_add_ps(_mm256_add_ps(m, y), _mm256_mul_ps(e, _mm256_set1_ps(0.693147180559945309f)));
+
+    return(_mm256_mul_ps(ln, _mm256_set1_ps(1.44269504088896341f)));
+}
+
+KERNEL_TARGET("avx2") static float EntropyAVX2(const int *counts, uint n, float N)
+{
+    __m256 d = _mm256_set1_ps(N);
+    __m256 one = _mm256_set1_ps(1.0f);
+    __m256 sum = _mm256_setzero_ps();
+
+    uint i = 0;
+
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(counts + i));
+        __m256 p = _mm256_div_ps(_mm256_cvtepi32_ps(c), d);
+        __m256 empty = _mm256_castsi256_ps(_mm256_cmpeq_epi32(c, _mm256_setzero_si256()));
+
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(p, Log2AVX2(_mm256_blendv_ps(p, one, empty))));
+    }
+
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+
+    float lanes[4];
+
+    _mm_storeu_ps(lanes, half);
+
+    return(EntropyScalar(counts + i, n - i, N) - ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])));
+}
+
+KERNEL_TARGET("avx2") static float SquaresAVX2(const int *counts, uint n, float N)
+{
+    __m256 d = _mm256_set1_ps(N);
+    __m256 sum = _mm256_setzero_ps();
+
+    uint i = 0;
+
+    for(; i + 8 <= n; i += 8)
+    {
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(counts + i));
+        __m256 p = _mm256_div_ps(_mm256_cvtepi32_ps(c), d);
+
+        sum = _mm256_add_ps(sum, _mm256_mul_ps(p, p));
+    }
+
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+
+    float lanes[4];
+
+    _mm_storeu_ps(lanes, half);
+
+    return(SquaresScalar(counts + i, n - i, N) + ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])));
+}
+
+KERNEL_TARGET("avx2") static uint BitmapAVX2(const uint64_t *lhs, const uint64_t *rhs, uint n, uint64_t *words,
+    bool complement)
+/*------------------------------------------------------------------------------
+nots | . bytes are counted by nibbles in a lookup table and summed into the four
+     |   64 bits lanes, a block of four words at a time.
+------------------------------------------------------------------------------*/
+{
+    __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i sum = _mm256_setzero_si256();
+
+    uint i = 0;
+
+    for(; i + 4 <= n; i += 4)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lhs + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rhs + i));
+        __m256i v = complement ? _mm256_andnot_si256(b, a) : _mm256_and_si256(a, b);
+
+        if(words) _mm256_storeu_si256(reinterpret_cast<__m256i *>(words + i), v);
+
+        __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble));
+        __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_add_epi8(low, high), zero));
+    }
+
+    uint64_t lanes[4];
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), sum);
+
+    uint total = (uint)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+
+    return(total + BitmapScalar(lhs + i, rhs + i, n - i, words ? words + i : nullptr, complement));
+}
+
+//------------------------------------------------------------------------| AVX512
+
+KERNEL_TARGET("avx512f") static void IndexAVX512(const uint *values, const uint *classes, uint n, uint K, uint *index)
+{
+    __m512i k = _mm512_set1_epi32((int)(K));
+
+    uint i = 0;
+
+    for(; i + 16 <= n; i += 16)
+    {
+        __m512i v = _mm512_loadu_si512(values + i);
+        __m512i c = _mm512_loadu_si512(classes + i);
+
+        _mm512_storeu_si512(index + i, _mm512_add_epi32(_mm512_mullo_epi32(v, k), c));
+    }
+
+    IndexScalar(values + i, classes + i, n - i, K, index + i);
+}
+
+KERNEL_TARGET("avx512f") static void ProportionAVX512(const int *counts, uint n, float N, float *p)
+{
+    __m512 d = _mm512_set1_ps(N);
+
+    uint i = 0;
+
+    for(; i + 16 <= n; i += 16)
+    {
+        __m512i c = _mm512_loadu_si512(counts + i);
+
+        _mm512_storeu_ps(p + i, _mm512_div_ps(_mm512_cvtepi32_ps(c), d));
+    }
+
+    ProportionScalar(counts + i, n - i, N, p + i);
+}
+
+KERNEL_TARGET("avx512f") static inline __m512 Log2AVX512(__m512 x)
+/*------------------------------------------------------------------------------
+nots | . as Log2SSE42, sixteen lanes at a time.
+------------------------------------------------------------------------------*/
+{
+    __m512i bits = _mm512_castps_si512(x);
+    __m512 one = _mm512_set1_ps(1.0f);
+
+    __m512 e = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23), _mm512_set1_epi32(126)));
+    __m512 m = _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(bits, _mm512_set1_epi32(0x007fffff)),
+                                                   _mm512_set1_epi32(0x3f000000)));
+
+    __mmask16 low = _mm512_cmp_ps_mask(m, _mm512_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+
+    e = _mm512_mask_sub_ps(e, low, e, one);
+    m = _mm512_sub_ps(_mm512_mask_add_ps(m, low, m, m), one);
+
+    __m512 z = _mm512_mul_ps(m, m);
+    __m512 y = _mm512_set1_ps(7.0376836292e-2f);
+
+    y = _mm512_add_ps(_mm512_mul_ps(y, m), _mm512_set1_ps(-1.1514610310e-1f));
+    y = _mm512_add_ps(_mm512_mul_ps(y, m), _mm512_set1_ps(1.1676998740e-1f));
+    y = _mm512_add_ps(_mm512_mul_ps(y, m), _mm512_set1_ps(-1.2420140846e-1f));
+    y = _mm512_add_ps(_mm512_mul_ps(y, m), _mm512_set1_ps(1.4249322787e-1f));
+    y = _mm512_add_ps(_mm512_mul_ps(y, m), _mm512_set1_ps(-1.6668057665e-1f));
+    y = _mm512_add_ps(_mm512_mul_ps(y, m), _mm512_set1_ps(2.0000714765e-1f));
+    y = _mm512_add_ps(_mm512_mul_ps(y, m), _mm512_set1_ps(-2.4999993993e-1f));
+    y = _mm512_add_ps(_mm512_mul_ps(y, m), _mm512_set1_ps(3.3333331174e-1f));
+    y = _mm512_mul_ps(_mm512_mul_ps(y, m), z);
+
+    y = _mm512_sub_ps(y, _mm512_mul_ps(_mm512_set1_ps(0.5f), z));
+
+    __m512 ln = _mm512_add_ps(_mm512_add_ps(m, y), _mm512_mul_ps(e, _mm512_set1_ps(0.693147180559945309f)));
+
+    return(_mm512_mul_ps(ln, _mm512_set1_ps(1.44269504088896341f)));
+}
+
+KERNEL_TARGET("avx512f") static inline float SumAVX512(__m512 sum)
+{
+    __m256 high = _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(sum), 1));
+    __m256 quarter = _mm256_add_ps(_mm512_castps512_ps256(sum), high);
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(quarter), _mm256_extractf128_ps(quarter, 1));
+
+    float lanes[4];
+
+    _mm_storeu_ps(lanes, half);
+
+    return((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]));
+}
+
+KERNEL_TARGET("avx512f") static float EntropyAVX512(const int *counts, uint n, float N)
+{
+    __m512 d = _mm512_set1_ps(N);
+    __m512 one = _mm512_set1_ps(1.0f);
+    __m512 sum = _mm512_setzero_ps();
+
+    uint i = 0;
+
+    for(; i + 16 <= n; i += 16)
+    {
+        __m512i c = _mm512_loadu_si512(counts + i);
+        __m512 p = _mm512_div_ps(_mm512_cvtepi32_ps(c), d);
+        __mmask16 empty = _mm512_cmpeq_epi32_mask(c, _mm512_setzero_si512());
+
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(p, Log2AVX512(_mm512_mask_blend_ps(empty, p, one))));
+    }
+
+    return(EntropyScalar(counts + i, n - i, N) - SumAVX512(sum));
+}
+
+KERNEL_TARGET("avx512f") static float SquaresAVX512(const int *counts, uint n, float N)
+{
+    __m512 d = _mm512_set1_ps(N);
+    __m512 sum = _mm512_setzero_ps();
+
+    uint i = 0;
+
+    for(; i + 16 <= n; i += 16)
+    {
+        __m512 p = _mm512_div_ps(_mm512_cvtepi32_ps(_mm512_loadu_si512(counts + i)), d);
+
+        sum = _mm512_add_ps(sum, _mm512_mul_ps(p, p));
+    }
+
+    return(SquaresScalar(counts + i, n - i, N) + SumAVX512(sum));
+}
+
+#endif
+
+//------------------------------------------------------------------------| Dispatch
+
+static IndexFunction GetIndexFunction(Kernel::Level level)
+{
+    switch(level)
+    {
+#if defined(KERNEL_X86)
+    case Kernel::AVX512 : return(IndexAVX512);
+    case Kernel::AVX2 : return(IndexAVX2);
+    case Kernel::SSE42 : return(IndexSSE42);
+#endif
+    default : return(IndexScalar);
+    }
+}
+
+static BitmapFunction GetBitmapFunction(Kernel::Level level)
+{
+    switch(level)
+    {
+#if defined(KERNEL_X86)
+    case Kernel::AVX512 :
+    case Kernel::AVX2 : return(BitmapAVX2);
+    case Kernel::SSE42 : return(BitmapSSE42);
+#endif
+    default : return(BitmapScalar);
+    }
+}
+
+static ProportionFunction GetProportionFunction(Kernel::Level level)
+{
+    switch(level)
+    {
+#if defined(KERNEL_X86)
+    case Kernel::AVX512 : return(ProportionAVX512);
+    case Kernel::AVX2 : return(ProportionAVX2);
+    case Kernel::SSE42 : return(ProportionSSE42);
+#endif
+    default : return(ProportionScalar);
+    }
+}
+
+static ReduceFunction GetEntropyFunction(Kernel::Level level)
+{
+    switch(level)
+    {
+#if defined(KERNEL_X86)
+    case Kernel::AVX512 : return(EntropyAVX512);
+    case Kernel::AVX2 : return(EntropyAVX2);
+    case Kernel::SSE42 : return(EntropySSE42);
+#endif
+    default : return(EntropyScalar);
+    }
+}
+
+static ReduceFunction GetSquaresFunction(Kernel::Level level)
+{
+    switch(level)
+    {
+#if defined(KERNEL_X86)
+    case Kernel::AVX512 : return(SquaresAVX512);
+    case Kernel::AVX2 : return(SquaresAVX2);
+    case Kernel::SSE42 : return(SquaresSSE42);
+#endif
+    default : return(SquaresScalar);
+    }
+}
+
+//------------------------------------------------------------------------| Kernel
+
+Kernel::Level Kernel::GetLevel(void)
+{
+    int level = current.load(std::memory_order_relaxed);
+
+    if(level < 0)
+    {
+        int expected = -1;
+
+        detected.compare_exchange_strong(expected, Detect());
+        expected = -1;
+        current.compare_exchange_strong(expected, detected.load());
+
+        level = current.load();
+    }
+
+    return((Level)(level));
+}
+
+void Kernel::SetLevel(Level level)
+/*------------------------------------------------------------------------------
+nots | . levels above the one of the CPU are lowered to it.
+------------------------------------------------------------------------------*/
+{
+    GetLevel();
+
+    current.store(std::min((int)(level), detected.load()));
+}
+
+bool Kernel::GetFused(void)
+{
+    return(fused.load(std::memory_order_relaxed));
+}
+
+void Kernel::SetFused(bool value)
+{
+    fused.store(value);
+}
+
+void Kernel::Count(const uint *values, uint V, const uint *classes, uint K, uint n, int *counts)
+/*------------------------------------------------------------------------------
+desc | . adds 1 to counts[values[i] * K + classes[i]] for every i < n.
+nots | . indexes are computed a block at a time and then scattered.
+------------------------------------------------------------------------------*/
+{
+    IndexFunction index = GetIndexFunction(GetLevel());
+
+    uint size = V * K;
+    uint indexes[block];
+
+    bool split = (size <= 4096) && (n >= 1024) && (n >= 8 * size);
+
+    std::vector <int> subcounts(split ? 4 * size : 0, 0);
+
+    for(uint i = 0; i < n; i += block)
+    {
+        uint m = std::min(block, n - i);
+
+        index(values + i, classes + i, m, K, indexes);
+
+        if(split)
+        {
+            uint j = 0;
+
+            for(; j + 4 <= m; j += 4)
+            {
+                ++subcounts[indexes[j]];
+                ++subcounts[size + indexes[j + 1]];
+                ++subcounts[2 * size + indexes[j + 2]];
+                ++subcounts[3 * size + indexes[j + 3]];
+            }
+
+            for(; j < m; ++j)
+                ++subcounts[indexes[j]];
+        }
+        else
+        {
+            for(uint j = 0; j < m; ++j)
+                ++counts[indexes[j]];
+        }
+    }
+
+    for(uint i = 0; split && (i < size); ++i)
+        counts[i] += subcounts[i] + subcounts[size + i] + subcounts[2 * size + i] + subcounts[3 * size + i];
+}
+
+float Kernel::Entropy(const int *counts, uint K, float N)
+/*------------------------------------------------------------------------------
+nots | . empty classes add nothing, as frecuencies only hold present values.
+------------------------------------------------------------------------------*/
+{
+    if(GetFused()) return(GetEntropyFunction(GetLevel())(counts, K, N));
+
+    ProportionFunction proportion = (K >= 8) ? GetProportionFunction(GetLevel()) : ProportionScalar;
+
+    float entropy = 0.0f;
+    float p[block];
+
+    for(uint i = 0; i < K; i += block)
+    {
+        uint m = std::min(block, K - i);
+
+        proportion(counts + i, m, N, p);
+
+        for(uint j = 0; j < m; ++j)
+        {
+            if(!counts[i + j]) continue;
+
+            entropy -= (p[j] * log2(p[j]));
+        }
+    }
+
+    return(entropy);
+}
+
+float Kernel::Gini(const int *counts, uint K, float N)
+{
+    if(GetFused()) return(1.0f - GetSquaresFunction(GetLevel())(counts, K, N));
+
+    ProportionFunction proportion = (K >= 8) ? GetProportionFunction(GetLevel()) : ProportionScalar;
+
+    float gini = 1.0f;
+    float p[block];
+
+    for(uint i = 0; i < K; i += block)
+    {
+        uint m = std::min(block, K - i);
+
+        proportion(counts + i, m, N, p);
+
+        for(uint j = 0; j < m; ++j)
+        {
+            if(!counts[i + j]) continue;
+
+            gini -= (p[j] * p[j]);
+        }
+    }
+
+    return(gini);
+}
+
+uint Kernel::And(const uint64_t *lhs, const uint64_t *rhs, uint n, uint64_t *words)
+/*------------------------------------------------------------------------------
+desc | . bits set in both bitmaps of n words, stored in words unless it is null.
+------------------------------------------------------------------------------*/
+{
+    return(GetBitmapFunction(GetLevel())(lhs, rhs, n, words, false));
+}
+
+uint Kernel::AndNot(const uint64_t *lhs, const uint64_t *rhs, uint n, uint64_t *words)
+/*------------------------------------------------------------------------------
+desc | . bits set in lhs and not in rhs, stored in words unless it is null.
+------------------------------------------------------------------------------*/
+{
+    return(GetBitmapFunction(GetLevel())(lhs, rhs, n, words, true));
+}
@@ -0,0 +1,55 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+namespace ML
+{
+//------------------------------------------------------------------------| Kernel
+
+class Kernel
+/*------------------------------------------------------------------------------
+desc | . inner loops of split statistics : class histograms, entropy and gini,
+     |   and of row bitmaps : intersections and differences with their counts.
+vars | level : instruction set used, the best one of the CPU unless lowered
+     | fused : off by default, Entropy and Gini then divide, take the log2 and
+     |   sum in vector registers, within 1e-5 of the exact value but not bit
+     |   exact to Scalar
+nots | . unless fused, every level gives the same bits as Scalar. Counts are
+     |   exact, proportions are correctly rounded divisions in every lane, and
+     |   the log2 terms are reduced in class order as in the scalar loop.
+     | . large inputs over small tables are counted in interleaved sub-histograms,
+     |   so consecutive rows of the same cell do not wait on each other.
+     | . bitmaps are counted with a nibble lookup under AVX2 and AVX512, which
+     |   has no wider byte shuffle without AVX512BW.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    enum Level {Scalar, SSE42, AVX2, AVX512};
+
+public :
+
+    static Level GetLevel(void);
+    static void SetLevel(Level level);
+
+    static bool GetFused(void);
+    static void SetFused(bool fused);
+
+    static void Count(const uint *values, uint V, const uint *classes, uint K, uint n, int *counts);
+
+    static float Entropy(const int *counts, uint K, float N);
+    static float Gini(const int *counts, uint K, float N);
+
+    static uint And(const uint64_t *lhs, const uint64_t *rhs, uint n, uint64_t *words = nullptr);
+    static uint AndNot(const uint64_t *lhs, const uint64_t *rhs, uint n, uint64_t *words = nullptr);
+};
+}
+
+#endif // KERNEL_H
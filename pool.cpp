@@ -0,0 +1,193 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#include <chrono>
+
+#include "pool.h"
+
+using namespace ML;
+
+//------------------------------------------------------------------------| Global
+
+static thread_local ThreadPool *currentPool = nullptr;
+static thread_local uint currentQueue = 0;
+
+//------------------------------------------------------------------------| ThreadPool
+
+ThreadPool::ThreadPool(uint threads) : queued(0), stop(false)
+/*------------------------------------------------------------------------------
+nots | . queues[threads] is the shared queue.
+------------------------------------------------------------------------------*/
+{
+    if(!threads) threads = std::thread::hardware_concurrency();
+    if(!threads) threads = 1;
+
+    for(uint i = 0; i <= threads; ++i)
+        queues.push_back(new Queue());
+
+    for(uint i = 0; i < threads; ++i)
+        workers.push_back(std::thread(&ThreadPool::Work, this, i));
+}
+
+ThreadPool::~ThreadPool(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        stop = true;
+    }
+
+    condition.notify_all();
+
+    for(std::thread &worker : workers)
+        worker.join();
+
+    for(Queue *queue : queues)
+        delete(queue);
+}
+
+uint ThreadPool::Size(void) const {return(workers.size());}
+
+void ThreadPool::Submit(const std::function<void(void)> &task)
+{
+    Queue *queue = queues[GetQueue()];
+
+    {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+
+        queue->tasks.push_back(task);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        ++queued;
+    }
+
+    condition.notify_one();
+}
+
+bool ThreadPool::RunPending(void)
+{
+    std::function<void(void)> task;
+
+    if(!Take(GetQueue(), task)) return(false);
+
+    task();
+
+    return(true);
+}
+
+uint ThreadPool::GetQueue(void) const
+{
+    return((currentPool == this) ? currentQueue : (uint)(workers.size()));
+}
+
+bool ThreadPool::Take(uint index, std::function<void(void)> &task)
+/*------------------------------------------------------------------------------
+nots | . own queue from the back, any other queue from the front.
+------------------------------------------------------------------------------*/
+{
+    if(queued <= 0) return(false);
+
+    for(uint i = 0, n = queues.size(); i < n; ++i)
+    {
+        Queue *queue = queues[(index + i) % n];
+
+        std::lock_guard<std::mutex> lock(queue->mutex);
+
+        if(queue->tasks.empty()) continue;
+
+        if(i == 0)
+        {
+            task = std::move(queue->tasks.back());
+            queue->tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue->tasks.front());
+            queue->tasks.pop_front();
+        }
+
+        --queued;
+
+        return(true);
+    }
+
+    return(false);
+}
+
+void ThreadPool::Work(uint index)
+{
+    currentPool = this;
+    currentQueue = index;
+
+    while(true)
+    {
+        std::function<void(void)> task;
+
+        if(Take(index, task))
+        {
+            task();
+
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        condition.wait(lock, [this](void) {return(stop || (queued > 0));});
+
+        if(stop && (queued <= 0)) return;
+    }
+}
+
+//------------------------------------------------------------------------| TaskGroup
+
+TaskGroup::TaskGroup(ThreadPool *pool) : pool(pool), pending(0) {}
+
+TaskGroup::~TaskGroup(void)
+{
+    Wait();
+}
+
+void TaskGroup::Run(const std::function<void(void)> &task)
+{
+    if(!pool)
+    {
+        task();
+
+        return;
+    }
+
+    ++pending;
+
+    pool->Submit([this, task](void)
+    {
+        task();
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if(--pending == 0)
+            condition.notify_all();
+    });
+}
+
+void TaskGroup::Wait(void)
+/*------------------------------------------------------------------------------
+nots | . while tasks of the group are pending, queued tasks are run here.
+------------------------------------------------------------------------------*/
+{
+    while(pending)
+    {
+        if(pool->RunPending()) continue;
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        condition.wait_for(lock, std::chrono::milliseconds(1), [this](void) {return(pending == 0);});
+    }
+
+    // '--> the last task releases the mutex after the count reaches zero.
+
+    std::lock_guard<std::mutex> lock(mutex);
+}
@@ -0,0 +1,115 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+typedef unsigned int uint;
+
+namespace ML
+{
+//------------------------------------------------------------------------| ThreadPool
+
+class ThreadPool
+/*------------------------------------------------------------------------------
+desc | . fixed set of worker threads running queued tasks.
+nots | . every worker owns a deque, it runs its newest task first and, when out
+     |   of work, steals the oldest task of another worker.
+     | . tasks submitted from outside the pool go to a shared queue.
+     | . threads waiting on a TaskGroup run queued tasks meanwhile, so tasks may
+     |   wait on nested groups without exhausting the workers.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    ThreadPool(uint threads = 0);
+    ~ThreadPool(void);
+
+    uint Size(void) const;
+
+    void Submit(const std::function<void(void)> &task);
+    bool RunPending(void);
+
+private :
+
+    struct Queue
+    {
+    public :
+
+        std::mutex mutex;
+        std::deque <std::function<void(void)> > tasks;
+    };
+
+private :
+
+    std::vector <std::thread> workers;
+    std::vector <Queue *> queues;
+
+    std::atomic <int> queued;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    bool stop;
+
+private :
+
+    uint GetQueue(void) const;
+
+    bool Take(uint index, std::function<void(void)> &task);
+
+    void Work(uint index);
+};
+
+//------------------------------------------------------------------------| TaskGroup
+
+class TaskGroup
+/*------------------------------------------------------------------------------
+desc | . set of tasks that can be waited for together.
+nots | . without pool, tasks run inline when added.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    TaskGroup(ThreadPool *pool);
+    ~TaskGroup(void);
+
+    void Run(const std::function<void(void)> &task);
+    void Wait(void);
+
+private :
+
+    ThreadPool *pool;
+
+    std::atomic <uint> pending;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+};
+
+//------------------------------------------------------------------------| Common
+
+template <class F> void ParallelFor(ThreadPool *pool, uint n, F function)
+/*------------------------------------------------------------------------------
+desc | . calls function(i) for every i in [0, n) and waits for all of them.
+------------------------------------------------------------------------------*/
+{
+    TaskGroup group(pool);
+
+    for(uint i = 0; i < n; ++i)
+        group.Run([&function, i](void) {function(i);});
+
+    group.Wait();
+}
+}
+
+#endif // POOL_H
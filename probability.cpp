@@ -11,71 +11,121 @@ using namespace ML;
 
 ProbabilityTree::ProbabilityTree(ubyte attributeSelection) : Tree(), attributeSelection(attributeSelection) {}
 
-ML::Node *ProbabilityTree::TreeInduction(DataFrame &subsamples, std::vector <std::wstring> subattributes)
+ML::Node *ProbabilityTree::TreeInduction(DataFrameView &subsamples, std::vector <uint> subcolumns,
+    Fragment &fragment)
+/*------------------------------------------------------------------------------
+vars | mintask : minimum rows for a subtree to be induced as a pool task.
+nots | . subcolumns are the ids of the attributes not yet in the path.
+     | . large subtrees are pool tasks, the rest are built meanwhile. Subtrees
+     |   before the first pool task are built in the fragment of their parent,
+     |   the others in a fragment of their own, appended in edge order.
+------------------------------------------------------------------------------*/
 {
-    Node *node = AddNode();
+    const uint mintask = 256;
 
-    bool leaf = (subattributes.size() == 1);
+    Node *node = fragment.AddNode();
 
-    std::wstring attribute;
+    bool leaf = (subcolumns.size() == 1);
 
-    switch(attributeSelection)
+    uint column = AttributeSelection::SelectColumn(subsamples, subcolumns, attributeSelection, leaf ? 0 : 1, pool);
+
+    if(column == (uint)-1)
     {
-    case 0 : attribute = AttributeSelection::InformationGain(subsamples, subattributes, leaf ? 0 : 1); break;
-    case 1 : attribute = AttributeSelection::GiniImpurity(subsamples, subattributes, leaf ? 0 : 1); break;
-    case 2 : attribute = AttributeSelection::ProportionGain(subsamples, subattributes, leaf ? 0 : 1); break;
+        node->leaf = true;
+
+        return(node);
     }
 
-    ClearAttribute(attribute, subattributes);
+    ClearColumn(column, subcolumns);
+
+    Attribute *factor = subsamples.dataframe->attributes[column];
+
+    node->data = factor->name;
+    node->column = column;
+
+    std::unique_ptr<std::vector<ML::Attribute::ProbabilityDistribution>> probabilityDistribution(
+        factor->GetProbabilityDistribution(subsamples));
 
-    node->data = attribute;
+    uint n = (*probabilityDistribution).size();
 
-    for(Attribute *factor : subsamples.attributes)
+    std::vector <const RowSet *> parts;
+
+    for(uint i = 0; (i < n) && !leaf; ++i)
+        parts.push_back(&(*probabilityDistribution)[i].indexes);
+
+    std::vector <DataFrameView> subviews = subsamples.Partition(parts);
+
+    auto induction = [this, &subviews, &subcolumns, &probabilityDistribution, node, leaf](uint i, Fragment &fragment)
     {
-        if(factor->name == attribute)
+        const Attribute::ProbabilityDistribution &distribution = (*probabilityDistribution)[i];
+
+        Node *child = nullptr;
+
+        if(leaf)
         {
-            std::vector<ML::Attribute::ProbabilityDistribution> *probabilityDistribution = factor->GetProbabilityDistribution();
+            child = fragment.AddNode();
 
-            for(uint i = 0, n = (*probabilityDistribution).size(); i < n; ++i)
-            {
-                Node *child = nullptr;
+            child->leaf = true;
+            child->data = distribution.value;
+        }
+        else
+            child = TreeInduction(subviews[i], subcolumns, fragment);
 
-                if(leaf)
-                {
-                    child = AddNode();
+        if(child) fragment.AddEdge(distribution.value, distribution.p, distribution.mathop, node, child);
+    };
 
-                    child->leaf = true;
-                    child->data = (*probabilityDistribution)[i].value;
-                }
-                else
-                {
-                    child = TreeInduction(*subsamples.GetSubDataFrame((*probabilityDistribution)[i].indexes), subattributes);
-                }
+    std::vector <Fragment> fragments(pool ? n : 0);
+    std::vector <bool> tasks(n, false);
 
-                if(child) AddEdge((*probabilityDistribution)[i].value, (*probabilityDistribution)[i].p,
-                                  (*probabilityDistribution)[i].mathop, node, child);
-            }
+    uint first = n;
 
-            delete(probabilityDistribution);
-        }
+    // '--> Large subtrees are pool tasks, built in their own fragment.
+
+    TaskGroup group(pool);
+
+    for(uint i = 0; (i < n) && pool && !leaf; ++i)
+    {
+        if((*probabilityDistribution)[i].indexes.Size() < mintask) continue;
+
+        tasks[i] = true;
+        first = std::min(first, i);
+
+        group.Run([&induction, &fragments, i](void) {induction(i, fragments[i]);});
+    }
+
+    // '--> The rest are built meanwhile, in place before the first task.
+
+    for(uint i = 0; i < n; ++i)
+    {
+        if(!tasks[i]) induction(i, (i < first) ? fragment : fragments[i]);
     }
 
+    group.Wait();
+
+    for(uint i = first; i < n; ++i)
+        fragment.Append(fragments[i]);
+
     return(node);
 }
 
 void ProbabilityTree::Build(void)
 {
-    DataFrame subsamples = samples;
+    DataFrameView subsamples(&samples);
 
-    std::vector <std::wstring> subattributes;
+    subsamples.Presort();
+
+    std::vector <uint> subcolumns;
 
     for(uint i = 0, n = samples.attributes.size(); i < n; ++i)
-        subattributes.push_back(samples.attributes[i]->name);
+        subcolumns.push_back(i);
+
+    Clear();
+
+    Fragment fragment;
 
-    clrptrvector<Node *>(nodes);
-    clrptrvector<Edge *>(edges);
+    TreeInduction(subsamples, subcolumns, fragment);
 
-    TreeInduction(subsamples, subattributes);
+    Append(fragment);
 
     RankHierarchy();
 }
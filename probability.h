@@ -26,7 +26,7 @@ public :
 
     ProbabilityTree(ubyte attributeSelection = 0);
 
-    Node *TreeInduction(DataFrame &subsamples, std::vector<std::wstring> subattributes);
+    Node *TreeInduction(DataFrameView &subsamples, std::vector<uint> subcolumns, Fragment &fragment);
 
     void Build(void);
 };
@@ -0,0 +1,713 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include "reader.h"
+
+using namespace ML;
+
+//------------------------------------------------------------------------| Global
+
+enum {BoolMask = 1, IntMask = 2, FloatMask = 4, SeenMask = 8};
+
+struct Field
+{
+    const char *begin;
+    const char *end;
+
+    bool quoted;
+};
+
+struct ChunkColumn
+/*------------------------------------------------------------------------------
+nots | . bools are kept in ints, strings as local codes of their UTF-8 bytes.
+------------------------------------------------------------------------------*/
+{
+    std::vector <int> ints;
+    std::vector <float> floats;
+    std::vector <uint> codes;
+
+    std::vector <std::string> strings;
+    std::unordered_map <std::string, uint> lookup;
+};
+
+struct Chunk
+{
+    const char *begin;
+    const char *end;
+
+    bool valid;
+
+    std::vector <ubyte> masks;
+    std::vector <ChunkColumn> columns;
+};
+
+static const char *SplitRow(const char *row, const char *end, char delimiter, std::vector <Field> &fields)
+/*------------------------------------------------------------------------------
+desc | . splits the row at row into fields and returns the start of the next row.
+nots | . text after the closing quote of a field is ignored.
+     | . a trailing \r is dropped.
+------------------------------------------------------------------------------*/
+{
+    const char *p = row;
+
+    fields.clear();
+
+    while(true)
+    {
+        Field field;
+
+        field.quoted = (p < end) && (*p == '"');
+
+        if(field.quoted)
+        {
+            field.begin = ++p;
+
+            while(p < end)
+            {
+                if(*p != '"')
+                    ++p;
+                else if((p + 1 < end) && (p[1] == '"'))
+                    p += 2;
+                else
+                    break;
+            }
+
+            field.end = p;
+
+            for(; (p < end) && (*p != delimiter) && (*p != '\n'); ++p);
+        }
+        else
+        {
+            field.begin = p;
+
+            for(; (p < end) && (*p != delimiter) && (*p != '\n'); ++p);
+
+            field.end = p;
+        }
+
+        fields.push_back(field);
+
+        if((p < end) && (*p == delimiter))
+            ++p;
+        else
+            break;
+    }
+
+    Field &last = fields.back();
+
+    if(!last.quoted && (last.end > last.begin) && (last.end[-1] == '\r')) --last.end;
+
+    return((p < end) ? p + 1 : p);
+}
+
+static bool IsBlank(const std::vector <Field> &fields)
+{
+    return((fields.size() == 1) && !fields[0].quoted && (fields[0].begin == fields[0].end));
+}
+
+static void GetText(const Field &field, std::string &text)
+{
+    text.assign(field.begin, field.end);
+
+    if(!field.quoted) return;
+
+    size_t j = 0;
+
+    for(size_t i = 0, n = text.size(); i < n; ++i, ++j)
+    {
+        text[j] = text[i];
+
+        if((text[i] == '"') && (i + 1 < n) && (text[i + 1] == '"')) ++i;
+    }
+
+    text.resize(j);
+}
+
+static void Trim(const char *&begin, const char *&end)
+{
+    for(; (begin < end) && (*begin == ' '); ++begin);
+    for(; (end > begin) && (end[-1] == ' '); --end);
+}
+
+static bool ParseInt(const char *begin, const char *end, int &value)
+{
+    Trim(begin, end);
+
+    bool negative = (begin < end) && (*begin == '-');
+
+    if((begin < end) && ((*begin == '-') || (*begin == '+'))) ++begin;
+
+    if(begin == end) return(false);
+
+    int64_t result = 0;
+
+    for(; begin < end; ++begin)
+    {
+        if((*begin < '0') || (*begin > '9')) return(false);
+
+        result = 10 * result + (*begin - '0');
+
+        if(result > (int64_t)(std::numeric_limits<int>::max()) + 1) return(false);
+    }
+
+    if(negative) result = -result;
+
+    if(result > std::numeric_limits<int>::max()) return(false);
+
+    value = (int)(result);
+
+    return(true);
+}
+
+static bool ParseFloat(const char *begin, const char *end, float &value)
+{
+    Trim(begin, end);
+
+    char buffer[64];
+
+    size_t size = end - begin;
+
+    if(!size || (size >= sizeof(buffer))) return(false);
+
+    memcpy(buffer, begin, size);
+    buffer[size] = '\0';
+
+    char *last = nullptr;
+
+    value = strtof(buffer, &last);
+
+    return(last == buffer + size);
+}
+
+static bool IsWord(const char *begin, const char *end, const char *word)
+{
+    size_t size = strlen(word);
+
+    if((size_t)(end - begin) != size) return(false);
+
+    for(size_t i = 0; i < size; ++i)
+    {
+        char c = begin[i];
+
+        if((c >= 'A') && (c <= 'Z')) c += 'a' - 'A';
+
+        if(c != word[i]) return(false);
+    }
+
+    return(true);
+}
+
+static bool ParseBool(const char *begin, const char *end, bool &value, bool digits = true)
+{
+    Trim(begin, end);
+
+    if(IsWord(begin, end, "true") || IsWord(begin, end, "verdadero") || (digits && IsWord(begin, end, "1")))
+        value = true;
+    else if(IsWord(begin, end, "false") || IsWord(begin, end, "falso") || (digits && IsWord(begin, end, "0")))
+        value = false;
+    else
+        return(false);
+
+    return(true);
+}
+
+static void Infer(Chunk &chunk, char delimiter, uint columns)
+/*------------------------------------------------------------------------------
+desc | . types every field of the chunk could be read as, by column.
+------------------------------------------------------------------------------*/
+{
+    std::vector <Field> fields;
+
+    chunk.masks.assign(columns, BoolMask | IntMask | FloatMask);
+
+    for(const char *row = chunk.begin; row < chunk.end;)
+    {
+        row = SplitRow(row, chunk.end, delimiter, fields);
+
+        if(IsBlank(fields)) continue;
+
+        for(uint c = 0, n = std::min<uint>(columns, fields.size()); c < n; ++c)
+        {
+            const Field &field = fields[c];
+
+            if(field.begin == field.end) continue;
+
+            bool b;
+            int i;
+            float f;
+
+            ubyte mask = SeenMask;
+
+            if(ParseBool(field.begin, field.end, b, false)) mask |= BoolMask;
+            if(ParseInt(field.begin, field.end, i)) mask |= IntMask;
+            if(ParseFloat(field.begin, field.end, f)) mask |= FloatMask;
+
+            chunk.masks[c] = (chunk.masks[c] & mask) | SeenMask;
+        }
+    }
+}
+
+static void Accumulate(std::vector <ubyte> &masks, const std::vector <Chunk> &chunks)
+/*------------------------------------------------------------------------------
+desc | . narrows masks with the masks inferred for chunks.
+nots | . chunks without masks are skipped, they were not inferred.
+------------------------------------------------------------------------------*/
+{
+    for(const Chunk &chunk : chunks)
+    {
+        if(chunk.masks.size() != masks.size()) continue;
+
+        for(uint c = 0, n = masks.size(); c < n; ++c)
+            masks[c] = (masks[c] & (chunk.masks[c] | SeenMask)) | (chunk.masks[c] & SeenMask);
+    }
+}
+
+static ubyte GetType(ubyte mask)
+{
+    if(!(mask & SeenMask)) return(DataFrame::WStringType);
+    if(mask & BoolMask) return(DataFrame::BoolType);
+    if(mask & IntMask) return(DataFrame::IntType);
+    if(mask & FloatMask) return(DataFrame::FloatType);
+
+    return(DataFrame::WStringType);
+}
+
+static void Parse(Chunk &chunk, char delimiter, const std::vector <ubyte> &types)
+{
+    std::vector <Field> fields;
+    std::string text;
+
+    Field empty;
+
+    empty.begin = empty.end = chunk.end;
+    empty.quoted = false;
+
+    uint columns = types.size();
+
+    chunk.valid = true;
+    chunk.columns.assign(columns, ChunkColumn());
+
+    for(const char *row = chunk.begin; row < chunk.end;)
+    {
+        row = SplitRow(row, chunk.end, delimiter, fields);
+
+        if(IsBlank(fields)) continue;
+
+        for(uint c = 0; c < columns; ++c)
+        {
+            const Field &field = (c < fields.size()) ? fields[c] : empty;
+
+            ChunkColumn &column = chunk.columns[c];
+
+            bool isEmpty = (field.begin == field.end);
+
+            switch(types[c])
+            {
+            case DataFrame::BoolType :
+            {
+                bool value = false;
+
+                if(!isEmpty && !ParseBool(field.begin, field.end, value)) chunk.valid = false;
+
+                column.ints.push_back(value ? 1 : 0);
+                break;
+            }
+            case DataFrame::IntType :
+            {
+                int value = 0;
+
+                if(!isEmpty && !ParseInt(field.begin, field.end, value)) chunk.valid = false;
+
+                column.ints.push_back(value);
+                break;
+            }
+            case DataFrame::FloatType :
+            {
+                float value = 0.0f;
+
+                if(!isEmpty && !ParseFloat(field.begin, field.end, value)) chunk.valid = false;
+
+                column.floats.push_back(value);
+                break;
+            }
+            default :
+            {
+                GetText(field, text);
+
+                auto it = column.lookup.find(text);
+
+                if(it == column.lookup.end())
+                {
+                    it = column.lookup.insert(std::pair<std::string, uint>(text, column.strings.size())).first;
+                    column.strings.push_back(text);
+                }
+
+                column.codes.push_back(it->second);
+            }
+            }
+
+            if(!chunk.valid) return;
+        }
+    }
+}
+
+template <class C> static void Reserve(C &cells, size_t size)
+{
+    if(size > cells.capacity()) cells.reserve(std::max(size, 2 * cells.size()));
+}
+
+static bool Merge(std::vector <Chunk> &chunks, uint c, Attribute *attribute, ubyte type)
+/*------------------------------------------------------------------------------
+desc | . appends column c of every chunk, in order, to attribute.
+nots | . strings get their dictionary codes in order of first appearance.
+------------------------------------------------------------------------------*/
+{
+    size_t rows = attribute->Size();
+
+    for(Chunk &chunk : chunks)
+    {
+        ChunkColumn &column = chunk.columns[c];
+
+        rows += column.ints.size() + column.floats.size() + column.codes.size();
+    }
+
+    for(Chunk &chunk : chunks)
+    {
+        ChunkColumn &column = chunk.columns[c];
+
+        switch(type)
+        {
+        case DataFrame::BoolType :
+        {
+            BitCells &cells = static_cast<BoolAttribute *>(attribute)->cells;
+
+            Reserve(cells, rows);
+
+            for(int value : column.ints)
+                cells.push_back(value != 0);
+            break;
+        }
+        case DataFrame::IntType :
+        {
+            Cells <int> &cells = static_cast<IntAttribute *>(attribute)->cells;
+
+            Reserve(cells, rows);
+
+            for(int value : column.ints)
+                cells.push_back(value);
+            break;
+        }
+        case DataFrame::FloatType :
+        {
+            Cells <float> &cells = static_cast<FloaAttribute *>(attribute)->cells;
+
+            Reserve(cells, rows);
+
+            for(float value : column.floats)
+                cells.push_back(value);
+            break;
+        }
+        default :
+        {
+            WStringAttribute *wstringAttribute = static_cast<WStringAttribute *>(attribute);
+
+            std::vector <uint> codes(column.strings.size());
+            std::wstring value;
+
+            for(uint i = 0, n = column.strings.size(); i < n; ++i)
+            {
+                if(!DecodeUTF8(reinterpret_cast<const unsigned char *>(column.strings[i].data()),
+                    column.strings[i].size(), value)) return(false);
+
+                codes[i] = wstringAttribute->dictionary.GetCode(value);
+            }
+
+            Reserve(wstringAttribute->cells, rows);
+
+            for(uint code : column.codes)
+                wstringAttribute->cells.push_back(codes[code]);
+        }
+        }
+
+        column = ChunkColumn();
+    }
+
+    return(true);
+}
+
+static Attribute *CreateAttribute(const std::wstring &name, ubyte type)
+{
+    switch(type)
+    {
+    case DataFrame::BoolType : return(new BoolAttribute(name));
+    case DataFrame::IntType : return(new IntAttribute(name));
+    case DataFrame::FloatType : return(new FloaAttribute(name));
+    case DataFrame::WStringType : return(new WStringAttribute(name));
+    }
+
+    return(nullptr);
+}
+
+//------------------------------------------------------------------------| Reader
+
+Reader::Reader(char delimiter, bool header, ThreadPool *pool) : delimiter(delimiter), header(header), pool(pool),
+    blockSize(64 << 20), chunkSize(1 << 20) {}
+
+bool Reader::Load(DataFrame &dataframe, const std::wstring &path)
+/*------------------------------------------------------------------------------
+desc | . replaces the columns of dataframe with the columns read from path.
+nots | . blocks are cut at row ends outside quotes, the incomplete last row is
+     |   carried to the next block.
+     | . inferred types are widened when a later block does not fit them, bool
+     |   to int to float to string, and the file is read again from the start.
+     | . dataframe is untouched on failure, as a field not matching a given type.
+------------------------------------------------------------------------------*/
+{
+    FILE *file = OpenFile(path, L"rb");
+
+    if(!file) return(false);
+
+    std::vector <Attribute *> attributes;
+    std::vector <ubyte> columnTypes = types;
+    std::vector <ubyte> masks;
+
+    bool inferred = types.empty();
+
+    std::vector <Field> fields;
+    std::string block;
+
+    bool first = true;
+    bool success = true;
+
+    while(success)
+    {
+        // '--> Read a block after the carried row.
+
+        size_t start = block.size();
+
+        block.resize(start + blockSize);
+        block.resize(start + fread(&block[start], 1, blockSize, file));
+
+        bool eof = (block.size() < start + blockSize);
+
+        // '--> Find row ends outside quotes, one every chunkSize bytes at least.
+        // '--> As in SplitRow, a quote only opens a field at its start.
+
+        std::vector <size_t> cuts(1, 0);
+
+        size_t last = 0;
+        bool quoted = false;
+        bool opening = true;
+
+        for(size_t i = 0, n = block.size(); i < n; ++i)
+        {
+            char c = block[i];
+
+            if(quoted)
+            {
+                if(c != '"') continue;
+
+                if((i + 1 < n) && (block[i + 1] == '"'))
+                    ++i;
+                else
+                    quoted = false;
+            }
+            else if((c == '"') && opening)
+            {
+                quoted = true;
+                opening = false;
+            }
+            else if(c == delimiter)
+                opening = true;
+            else if(c == '\n')
+            {
+                opening = true;
+                last = i + 1;
+
+                if(last - cuts.back() >= chunkSize) cuts.push_back(last);
+            }
+            else
+                opening = false;
+        }
+
+        if(eof) last = block.size();
+
+        if(!last)
+        {
+            if(eof) break;
+
+            continue;
+        }
+
+        const char *data = block.data();
+
+        // '--> First block : names, the header row is skipped.
+
+        std::vector <std::wstring> names;
+
+        if(first)
+        {
+            const char *body = SplitRow(data, data + last, delimiter, fields);
+
+            std::string text;
+            std::wstring name;
+
+            for(uint c = 0, n = fields.size(); c < n; ++c)
+            {
+                GetText(fields[c], text);
+
+                if(!header)
+                    name = L"Column " + std::to_wstring(c + 1);
+                else if(!DecodeUTF8(reinterpret_cast<const unsigned char *>(text.data()), text.size(), name))
+                    success = false;
+
+                names.push_back(name);
+            }
+
+            size_t begin = header ? body - data : 0;
+
+            while((cuts.size() > 1) && (cuts[1] <= begin)) cuts.erase(cuts.begin() + 1);
+
+            cuts[0] = begin;
+        }
+
+        if(!success) break;
+
+        if(cuts.back() != last) cuts.push_back(last);
+
+        std::vector <Chunk> chunks(cuts.size() - 1);
+
+        for(uint i = 0, n = chunks.size(); i < n; ++i)
+        {
+            chunks[i].begin = data + cuts[i];
+            chunks[i].end = data + cuts[i + 1];
+        }
+
+        // '--> First block : types, inferred from its chunks unless given.
+
+        if(first)
+        {
+            uint columns = names.size();
+
+            if(columnTypes.empty())
+            {
+                ParallelFor(pool, chunks.size(), [&](uint i) {Infer(chunks[i], delimiter, columns);});
+
+                masks.assign(columns, BoolMask | IntMask | FloatMask);
+
+                Accumulate(masks, chunks);
+
+                for(ubyte mask : masks)
+                    columnTypes.push_back(GetType(mask));
+            }
+
+            if(columnTypes.size() != columns)
+            {
+                success = false;
+                break;
+            }
+
+            for(uint c = 0; c < columns; ++c)
+            {
+                Attribute *attribute = CreateAttribute(names[c], columnTypes[c]);
+
+                if(!attribute)
+                    success = false;
+                else
+                    attributes.push_back(attribute);
+            }
+
+            if(!success) break;
+
+            first = false;
+        }
+
+        // '--> Parse chunks, then append them column by column.
+
+        ParallelFor(pool, chunks.size(), [&](uint i) {Parse(chunks[i], delimiter, columnTypes);});
+
+        bool valid = true;
+
+        for(Chunk &chunk : chunks)
+            valid = valid && chunk.valid;
+
+        // '--> A block not fitting inferred types widens them, the load starts over.
+
+        if(!valid)
+        {
+            if(!inferred)
+            {
+                success = false;
+                break;
+            }
+
+            uint columns = columnTypes.size();
+
+            ParallelFor(pool, chunks.size(), [&](uint i)
+            {
+                if(!chunks[i].valid) Infer(chunks[i], delimiter, columns);
+            });
+
+            Accumulate(masks, chunks);
+
+            bool widened = false;
+
+            for(uint c = 0; c < columns; ++c)
+            {
+                ubyte type = GetType(masks[c]);
+
+                widened = widened || (type != columnTypes[c]);
+
+                columnTypes[c] = type;
+            }
+
+            if(!widened)
+            {
+                success = false;
+                break;
+            }
+
+            clrptrvector<Attribute *>(attributes);
+
+            rewind(file);
+
+            block.clear();
+            first = true;
+
+            continue;
+        }
+
+        std::vector <ubyte> merged(attributes.size(), 0);
+
+        ParallelFor(pool, attributes.size(), [&](uint c)
+        {
+            merged[c] = Merge(chunks, c, attributes[c], columnTypes[c]) ? 1 : 0;
+        });
+
+        for(ubyte result : merged)
+            success = success && result;
+
+        block.erase(0, last);
+
+        if(eof) break;
+    }
+
+    fclose(file);
+
+    if(!success || attributes.empty())
+    {
+        clrptrvector<Attribute *>(attributes);
+        return(false);
+    }
+
+    dataframe.Clear();
+    dataframe.attributes = attributes;
+
+    return(true);
+}
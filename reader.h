@@ -0,0 +1,53 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#ifndef READER_H
+#define READER_H
+
+#include <string>
+#include <vector>
+
+#include "core.h"
+#include "pool.h"
+
+namespace ML
+{
+//------------------------------------------------------------------------| Reader
+
+class Reader
+/*------------------------------------------------------------------------------
+desc | . reads delimited text (CSV, TSV) into the typed columns of a dataframe.
+vars | types : DataFrame::AttributeType by column, inferred if empty, from the first
+     |   block and widened by any later block that does not fit them
+     | pool : if given, chunks of a block are parsed concurrently
+     | blockSize : bytes read from the file at once
+     | chunkSize : bytes parsed by one task
+nots | . text is UTF-8, fields may be quoted with " and "" stands for a quote.
+     | . the first row holds the column names if header is set.
+     | . bools are true/false, Verdadero/Falso or 1/0, case insensitive, but 1/0
+     |   columns are inferred as int.
+     | . empty fields read as false, 0, 0.0 or "".
+------------------------------------------------------------------------------*/
+{
+public :
+
+    char delimiter;
+    bool header;
+
+    std::vector <ubyte> types;
+
+    ThreadPool *pool;
+
+    uint blockSize;
+    uint chunkSize;
+
+public :
+
+    Reader(char delimiter = ',', bool header = true, ThreadPool *pool = nullptr);
+
+    bool Load(DataFrame &dataframe, const std::wstring &path);
+};
+}
+
+#endif // READER_H
@@ -0,0 +1,776 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#include <algorithm>
+#include <iterator>
+
+#include "rowset.h"
+#include "kernel.h"
+
+using namespace ML;
+
+//------------------------------------------------------------------------| Iterator
+
+RowSet::Iterator::Iterator(const RowSet *rowset, uint position) : rowset(rowset), chunk(0), position(position),
+    bits(0)
+/*------------------------------------------------------------------------------
+vars | position : row of a range, chunk of a chunked set
+------------------------------------------------------------------------------*/
+{
+    if(rowset->representation == Range) return;
+
+    chunk = position;
+
+    Load();
+}
+
+void RowSet::Iterator::Load(void)
+/*------------------------------------------------------------------------------
+desc | . moves to the first row of the current chunk, or of the next not empty.
+------------------------------------------------------------------------------*/
+{
+    for(uint n = rowset->chunks.size(); chunk < n; ++chunk)
+    {
+        const Chunk &current = rowset->chunks[chunk];
+
+        position = 0;
+
+        if(current.words.empty())
+        {
+            if(!current.indexes.empty()) return;
+
+            continue;
+        }
+
+        for(uint m = current.words.size(); position < m; ++position)
+        {
+            bits = current.words[position];
+
+            if(bits) return;
+        }
+    }
+
+    position = 0;
+    bits = 0;
+}
+
+uint RowSet::Iterator::operator*(void) const
+{
+    if(rowset->representation == Range) return(position);
+
+    const Chunk &current = rowset->chunks[chunk];
+
+    uint base = current.key << chunkBits;
+
+    if(current.words.empty()) return(base + current.indexes[position]);
+
+    return(base + (position << 6) + ctz64(bits));
+}
+
+RowSet::Iterator &RowSet::Iterator::operator++(void)
+{
+    if(rowset->representation == Range)
+    {
+        ++position;
+
+        return(*this);
+    }
+
+    const Chunk &current = rowset->chunks[chunk];
+
+    if(current.words.empty())
+    {
+        if(++position < current.indexes.size()) return(*this);
+    }
+    else
+    {
+        bits &= (bits - 1);
+
+        for(uint m = current.words.size(); !bits && (++position < m);)
+            bits = current.words[position];
+
+        if(bits) return(*this);
+    }
+
+    ++chunk;
+
+    Load();
+
+    return(*this);
+}
+
+bool RowSet::Iterator::operator==(const Iterator &rhs) const
+{
+    return((chunk == rhs.chunk) && (position == rhs.position) && (bits == rhs.bits));
+}
+
+bool RowSet::Iterator::operator!=(const Iterator &rhs) const
+{
+    return(!(*this == rhs));
+}
+
+//------------------------------------------------------------------------| RowSet
+
+RowSet::RowSet(void) : representation(Chunks), universe(0), count(0), id(0) {}
+
+RowSet::RowSet(const std::vector <uint> &indexes) : representation(Chunks), universe(0), count(0), id(0)
+{
+    std::vector <uint> sorted(indexes);
+
+    if(!std::is_sorted(sorted.begin(), sorted.end()))
+        std::sort(sorted.begin(), sorted.end());
+
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    for(uint index : sorted)
+        PushBack(index);
+
+    Compact();
+}
+
+RowSet::RowSet(std::initializer_list <uint> indexes) : RowSet(std::vector <uint>(indexes)) {}
+
+RowSet::RowSet(const RowSet &rhs) : representation(rhs.representation), universe(rhs.universe), count(rhs.count),
+    chunks(rhs.chunks), id(rhs.id.load()) {}
+
+RowSet::RowSet(RowSet &&rhs) : representation(rhs.representation), universe(rhs.universe), count(rhs.count),
+    chunks(std::move(rhs.chunks)), id(rhs.id.load())
+{
+    rhs.Clear();
+}
+
+RowSet &RowSet::operator=(const RowSet &rhs)
+{
+    if(this == &rhs) return(*this);
+
+    representation = rhs.representation;
+    universe = rhs.universe;
+    count = rhs.count;
+    chunks = rhs.chunks;
+    id = rhs.id.load();
+
+    return(*this);
+}
+
+RowSet &RowSet::operator=(RowSet &&rhs)
+{
+    if(this == &rhs) return(*this);
+
+    representation = rhs.representation;
+    universe = rhs.universe;
+    count = rhs.count;
+    chunks = std::move(rhs.chunks);
+    id = rhs.id.load();
+
+    rhs.Clear();
+
+    return(*this);
+}
+
+RowSet RowSet::GetRange(uint universe)
+{
+    RowSet rowset;
+
+    rowset.representation = Range;
+    rowset.universe = universe;
+    rowset.count = universe;
+
+    return(rowset);
+}
+
+RowSet::Representation RowSet::GetRepresentation(void) const {return(representation);}
+
+uint RowSet::Size(void) const {return(count);}
+
+uint RowSet::Universe(void) const {return(universe);}
+
+bool RowSet::IsEmpty(void) const {return(count == 0);}
+
+bool RowSet::Contains(uint index) const
+{
+    if(index >= universe) return(false);
+
+    if(representation == Range) return(true);
+
+    const Chunk *chunk = Find(index >> chunkBits);
+
+    if(!chunk) return(false);
+
+    uint low = index & ((1u << chunkBits) - 1);
+
+    if(chunk->words.empty()) return(std::binary_search(chunk->indexes.begin(), chunk->indexes.end(), low));
+
+    return(((low >> 6) < chunk->words.size()) && ((chunk->words[low >> 6] >> (low & 63)) & 1));
+}
+
+uint64_t RowSet::Id(void) const
+/*------------------------------------------------------------------------------
+nots | . ids are never 0 nor reused, concurrent callers get the same one.
+------------------------------------------------------------------------------*/
+{
+    static std::atomic <uint64_t> last(0);
+
+    uint64_t current = id.load();
+
+    if(current) return(current);
+
+    uint64_t drawn = ++last;
+
+    return(id.compare_exchange_strong(current, drawn) ? drawn : current);
+}
+
+bool RowSet::HasId(void) const
+/*------------------------------------------------------------------------------
+desc | . whether an id was drawn for the rows, without drawing one.
+------------------------------------------------------------------------------*/
+{
+    return(id.load() != 0);
+}
+
+void RowSet::Clear(void)
+{
+    representation = Chunks;
+    universe = 0;
+    count = 0;
+
+    chunks.clear();
+
+    id = 0;
+}
+
+void RowSet::PushBack(uint index)
+/*------------------------------------------------------------------------------
+nots | . index must be greater than any index already in the set.
+     | . a chunk turns into a bitmap as soon as its sorted indexes outgrow it.
+------------------------------------------------------------------------------*/
+{
+    id.store(0, std::memory_order_relaxed);
+
+    if(representation == Range)
+    {
+        if(index == universe)
+        {
+            ++universe;
+            ++count;
+
+            return;
+        }
+
+        uint range = universe;
+
+        representation = Chunks;
+        universe = 0;
+        count = 0;
+
+        for(uint i = 0; i < range; ++i)
+            PushBack(i);
+    }
+
+    uint key = index >> chunkBits;
+
+    if(chunks.empty() || (chunks.back().key != key))
+    {
+        chunks.push_back(Chunk());
+        chunks.back().key = key;
+    }
+
+    Chunk &chunk = chunks.back();
+
+    uint low = index & ((1u << chunkBits) - 1);
+
+    if(chunk.words.empty())
+    {
+        chunk.indexes.push_back((uint16_t)(low));
+
+        if(chunk.indexes.size() > chunkSorted)
+            ToBitmap(chunk);
+    }
+    else
+    {
+        chunk.words.resize((low >> 6) + 1, 0);
+        chunk.words[low >> 6] |= (uint64_t(1) << (low & 63));
+    }
+
+    ++chunk.count;
+
+    universe = index + 1;
+    ++count;
+}
+
+void RowSet::Compact(void)
+/*------------------------------------------------------------------------------
+nots | . a sorted index takes 16 bits per row, a bitmap 1 bit per row of the
+     |   span of its chunk, up to its last row.
+------------------------------------------------------------------------------*/
+{
+    for(Chunk &chunk : chunks)
+    {
+        bool dense = (chunk.count * 16 > GetSpan(chunk));
+
+        if(chunk.words.empty() && dense)
+            ToBitmap(chunk);
+        else if(!chunk.words.empty() && !dense)
+            ToSorted(chunk);
+    }
+}
+
+RowSet RowSet::Intersection(const RowSet &rhs) const
+{
+    if(representation == Range)
+    {
+        if(rhs.universe <= universe) return(rhs);
+
+        return(rhs.Intersection(*this));
+    }
+
+    if(rhs.representation == Range)
+    {
+        if(universe <= rhs.universe) return(*this);
+
+        RowSet rowset;
+
+        for(Iterator it = begin(), last = end(); (it != last) && (*it < rhs.universe); ++it)
+            rowset.PushBack(*it);
+
+        rowset.Compact();
+
+        return(rowset);
+    }
+
+    RowSet rowset;
+
+    for(uint i = 0, j = 0, n = chunks.size(), m = rhs.chunks.size(); (i < n) && (j < m);)
+    {
+        if(chunks[i].key < rhs.chunks[j].key) {++i; continue;}
+        if(rhs.chunks[j].key < chunks[i].key) {++j; continue;}
+
+        Chunk chunk;
+
+        chunk.key = chunks[i].key;
+
+        Intersect(chunks[i++], rhs.chunks[j++], chunk);
+
+        if(chunk.count) rowset.chunks.push_back(std::move(chunk));
+    }
+
+    rowset.Trim();
+    rowset.Compact();
+
+    return(rowset);
+}
+
+uint RowSet::IntersectionSize(const RowSet &rhs) const
+/*------------------------------------------------------------------------------
+nots | . nothing is built, chunks are only counted.
+------------------------------------------------------------------------------*/
+{
+    if(representation == Range) return(rhs.Rank(universe));
+
+    if(rhs.representation == Range) return(Rank(rhs.universe));
+
+    uint total = 0;
+
+    for(uint i = 0, j = 0, n = chunks.size(), m = rhs.chunks.size(); (i < n) && (j < m);)
+    {
+        if(chunks[i].key < rhs.chunks[j].key) {++i; continue;}
+        if(rhs.chunks[j].key < chunks[i].key) {++j; continue;}
+
+        total += Overlap(chunks[i++], rhs.chunks[j++]);
+    }
+
+    return(total);
+}
+
+RowSet RowSet::Difference(const RowSet &rhs) const
+/*------------------------------------------------------------------------------
+desc | . rows of the set that are not in rhs.
+------------------------------------------------------------------------------*/
+{
+    RowSet rowset;
+
+    if((representation == Range) || (rhs.representation == Range))
+    {
+        for(uint index : *this)
+        {
+            if(!rhs.Contains(index))
+                rowset.PushBack(index);
+        }
+    }
+    else
+    {
+        for(uint i = 0, j = 0, n = chunks.size(), m = rhs.chunks.size(); i < n; ++i)
+        {
+            while((j < m) && (rhs.chunks[j].key < chunks[i].key)) ++j;
+
+            if((j == m) || (rhs.chunks[j].key != chunks[i].key))
+            {
+                rowset.chunks.push_back(chunks[i]);
+
+                continue;
+            }
+
+            Chunk chunk;
+
+            chunk.key = chunks[i].key;
+
+            Subtract(chunks[i], rhs.chunks[j], chunk);
+
+            if(chunk.count) rowset.chunks.push_back(std::move(chunk));
+        }
+
+        rowset.Trim();
+    }
+
+    rowset.Compact();
+
+    return(rowset);
+}
+
+uint RowSet::DifferenceSize(const RowSet &rhs) const
+{
+    return(count - IntersectionSize(rhs));
+}
+
+uint RowSet::IntersectionSize(const uint64_t *bits, uint size) const
+/*------------------------------------------------------------------------------
+desc | . rows of the set whose bit is set in a bitmap of size bits.
+nots | . ranges and bitmap chunks are counted a word at a time.
+------------------------------------------------------------------------------*/
+{
+    uint total = 0;
+
+    if(representation == Range)
+    {
+        uint n = std::min(universe, size);
+
+        for(uint i = 0, m = n >> 6; i < m; ++i)
+            total += popcount64(bits[i]);
+
+        if(n & 63) total += popcount64(bits[n >> 6] & ((uint64_t(1) << (n & 63)) - 1));
+
+        return(total);
+    }
+
+    uint full = size >> 6;
+
+    for(const Chunk &chunk : chunks)
+    {
+        uint base = chunk.key << chunkBits;
+
+        if(base >= size) break;
+
+        if(chunk.words.empty())
+        {
+            for(uint16_t low : chunk.indexes)
+            {
+                uint index = base + low;
+
+                if(index >= size) break;
+
+                total += (bits[index >> 6] >> (index & 63)) & 1;
+            }
+
+            continue;
+        }
+
+        uint first = chunk.key * chunkWords;
+        uint n = std::min((uint)(chunk.words.size()), full - first);
+
+        if(n) total += Kernel::And(chunk.words.data(), bits + first, n);
+
+        if((n < chunk.words.size()) && (size & 63))
+            total += popcount64(chunk.words[n] & bits[full] & ((uint64_t(1) << (size & 63)) - 1));
+    }
+
+    return(total);
+}
+
+std::vector <uint> RowSet::ToVector(void) const
+{
+    std::vector <uint> vector;
+
+    vector.reserve(count);
+
+    for(uint index : *this)
+        vector.push_back(index);
+
+    return(vector);
+}
+
+RowSet::Iterator RowSet::begin(void) const
+{
+    return(Iterator(this, 0));
+}
+
+RowSet::Iterator RowSet::end(void) const
+{
+    return(Iterator(this, (representation == Range) ? universe : chunks.size()));
+}
+
+const RowSet::Chunk *RowSet::Find(uint key) const
+{
+    auto it = std::lower_bound(chunks.begin(), chunks.end(), key,
+        [](const Chunk &chunk, uint key) {return(chunk.key < key);});
+
+    return(((it != chunks.end()) && (it->key == key)) ? &(*it) : nullptr);
+}
+
+uint RowSet::Rank(uint bound) const
+/*------------------------------------------------------------------------------
+desc | . rows of the set below bound.
+------------------------------------------------------------------------------*/
+{
+    if(representation == Range) return(std::min(universe, bound));
+
+    uint total = 0;
+
+    for(const Chunk &chunk : chunks)
+    {
+        uint base = chunk.key << chunkBits;
+
+        if(base >= bound) break;
+
+        if(bound - base >= (1u << chunkBits))
+        {
+            total += chunk.count;
+
+            continue;
+        }
+
+        uint low = bound - base;
+
+        if(chunk.words.empty())
+            total += std::lower_bound(chunk.indexes.begin(), chunk.indexes.end(), low) - chunk.indexes.begin();
+        else
+        {
+            uint m = std::min(low >> 6, (uint)(chunk.words.size()));
+
+            for(uint i = 0; i < m; ++i)
+                total += popcount64(chunk.words[i]);
+
+            if((m == (low >> 6)) && (m < chunk.words.size()) && (low & 63))
+                total += popcount64(chunk.words[m] & ((uint64_t(1) << (low & 63)) - 1));
+        }
+    }
+
+    return(total);
+}
+
+void RowSet::Trim(void)
+/*------------------------------------------------------------------------------
+desc | . sets the size and the universe of chunks built by an operation.
+nots | . chunks must not be empty.
+------------------------------------------------------------------------------*/
+{
+    count = 0;
+    universe = 0;
+
+    for(const Chunk &chunk : chunks)
+        count += chunk.count;
+
+    if(chunks.empty()) return;
+
+    universe = (chunks.back().key << chunkBits) + GetSpan(chunks.back());
+}
+
+uint RowSet::GetSpan(const Chunk &chunk)
+/*------------------------------------------------------------------------------
+desc | . last row of a chunk plus one, relative to its first row.
+------------------------------------------------------------------------------*/
+{
+    if(chunk.words.empty()) return(chunk.indexes.empty() ? 0 : (chunk.indexes.back() + 1));
+
+    for(uint i = chunk.words.size(); i > 0; --i)
+    {
+        uint64_t word = chunk.words[i - 1];
+
+        if(!word) continue;
+
+        uint bit = 63;
+
+        while(!((word >> bit) & 1)) --bit;
+
+        return(((i - 1) << 6) + bit + 1);
+    }
+
+    return(0);
+}
+
+bool RowSet::Test(const Chunk &bitmap, uint low)
+{
+    return(((low >> 6) < bitmap.words.size()) && ((bitmap.words[low >> 6] >> (low & 63)) & 1));
+}
+
+void RowSet::Shrink(Chunk &bitmap)
+/*------------------------------------------------------------------------------
+desc | . drops the empty words at the end of a bitmap.
+------------------------------------------------------------------------------*/
+{
+    while(!bitmap.words.empty() && !bitmap.words.back())
+        bitmap.words.pop_back();
+}
+
+void RowSet::ToBitmap(Chunk &chunk)
+{
+    chunk.words.assign((chunk.indexes.back() >> 6) + 1, 0);
+
+    for(uint16_t low : chunk.indexes)
+        chunk.words[low >> 6] |= (uint64_t(1) << (low & 63));
+
+    std::vector <uint16_t>().swap(chunk.indexes);
+}
+
+void RowSet::ToSorted(Chunk &chunk)
+{
+    chunk.indexes.reserve(chunk.count);
+
+    for(uint i = 0, n = chunk.words.size(); i < n; ++i)
+    {
+        for(uint64_t word = chunk.words[i]; word; word &= (word - 1))
+            chunk.indexes.push_back((uint16_t)((i << 6) + ctz64(word)));
+    }
+
+    std::vector <uint64_t>().swap(chunk.words);
+}
+
+void RowSet::Intersect(const Chunk &lhs, const Chunk &rhs, Chunk &chunk)
+/*------------------------------------------------------------------------------
+nots | . sorted indexes are searched in the larger list from the last match on.
+------------------------------------------------------------------------------*/
+{
+    if(!lhs.words.empty() && !rhs.words.empty())
+    {
+        uint n = std::min(lhs.words.size(), rhs.words.size());
+
+        chunk.words.resize(n);
+        chunk.count = Kernel::And(lhs.words.data(), rhs.words.data(), n, chunk.words.data());
+
+        Shrink(chunk);
+
+        return;
+    }
+
+    if(!lhs.words.empty() || !rhs.words.empty())
+    {
+        const Chunk &sorted = lhs.words.empty() ? lhs : rhs;
+        const Chunk &bitmap = lhs.words.empty() ? rhs : lhs;
+
+        for(uint16_t low : sorted.indexes)
+        {
+            if(Test(bitmap, low))
+                chunk.indexes.push_back(low);
+        }
+    }
+    else
+    {
+        const std::vector <uint16_t> &small = (lhs.count <= rhs.count) ? lhs.indexes : rhs.indexes;
+        const std::vector <uint16_t> &large = (lhs.count <= rhs.count) ? rhs.indexes : lhs.indexes;
+
+        auto it = large.begin();
+
+        for(uint16_t low : small)
+        {
+            it = std::lower_bound(it, large.end(), low);
+
+            if(it == large.end()) break;
+
+            if(*it == low)
+                chunk.indexes.push_back(low);
+        }
+    }
+
+    chunk.count = chunk.indexes.size();
+}
+
+uint RowSet::Overlap(const Chunk &lhs, const Chunk &rhs)
+/*------------------------------------------------------------------------------
+desc | . rows in both chunks, as Intersect without building them.
+------------------------------------------------------------------------------*/
+{
+    if(!lhs.words.empty() && !rhs.words.empty())
+        return(Kernel::And(lhs.words.data(), rhs.words.data(), std::min(lhs.words.size(), rhs.words.size())));
+
+    uint total = 0;
+
+    if(!lhs.words.empty() || !rhs.words.empty())
+    {
+        const Chunk &sorted = lhs.words.empty() ? lhs : rhs;
+        const Chunk &bitmap = lhs.words.empty() ? rhs : lhs;
+
+        for(uint16_t low : sorted.indexes)
+            total += Test(bitmap, low);
+    }
+    else
+    {
+        const std::vector <uint16_t> &small = (lhs.count <= rhs.count) ? lhs.indexes : rhs.indexes;
+        const std::vector <uint16_t> &large = (lhs.count <= rhs.count) ? rhs.indexes : lhs.indexes;
+
+        auto it = large.begin();
+
+        for(uint16_t low : small)
+        {
+            it = std::lower_bound(it, large.end(), low);
+
+            if(it == large.end()) break;
+
+            if(*it == low) ++total;
+        }
+    }
+
+    return(total);
+}
+
+void RowSet::Subtract(const Chunk &lhs, const Chunk &rhs, Chunk &chunk)
+/*------------------------------------------------------------------------------
+desc | . rows of lhs that are not in rhs.
+------------------------------------------------------------------------------*/
+{
+    if(!lhs.words.empty())
+    {
+        if(!rhs.words.empty())
+        {
+            uint n = std::min(lhs.words.size(), rhs.words.size());
+
+            chunk.words.resize(lhs.words.size());
+            chunk.count = Kernel::AndNot(lhs.words.data(), rhs.words.data(), n, chunk.words.data());
+
+            for(uint i = n, m = lhs.words.size(); i < m; ++i)
+            {
+                chunk.words[i] = lhs.words[i];
+                chunk.count += popcount64(lhs.words[i]);
+            }
+        }
+        else
+        {
+            chunk.words = lhs.words;
+            chunk.count = lhs.count;
+
+            for(uint16_t low : rhs.indexes)
+            {
+                if(!Test(chunk, low)) continue;
+
+                chunk.words[low >> 6] &= ~(uint64_t(1) << (low & 63));
+                --chunk.count;
+            }
+        }
+
+        Shrink(chunk);
+
+        return;
+    }
+
+    if(!rhs.words.empty())
+    {
+        for(uint16_t low : lhs.indexes)
+        {
+            if(!Test(rhs, low))
+                chunk.indexes.push_back(low);
+        }
+    }
+    else
+        std::set_difference(lhs.indexes.begin(), lhs.indexes.end(), rhs.indexes.begin(), rhs.indexes.end(),
+            std::back_inserter(chunk.indexes));
+
+    chunk.count = chunk.indexes.size();
+}
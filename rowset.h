@@ -0,0 +1,181 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#ifndef ROWSET_H
+#define ROWSET_H
+
+#include <atomic>
+#include <vector>
+#include <initializer_list>
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+typedef unsigned int uint;
+
+namespace ML
+{
+//------------------------------------------------------------------------| Global
+
+inline uint popcount64(uint64_t word)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    return((uint)(__popcnt64(word)));
+#elif defined(_MSC_VER)
+    return((uint)(__popcnt((unsigned int)(word)) + __popcnt((unsigned int)(word >> 32))));
+#else
+    return((uint)(__builtin_popcountll(word)));
+#endif
+}
+
+inline uint ctz64(uint64_t word)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+    return((uint)(index));
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if(_BitScanForward(&index, (unsigned long)(word))) return((uint)(index));
+    _BitScanForward(&index, (unsigned long)(word >> 32));
+    return((uint)(index) + 32);
+#else
+    return((uint)(__builtin_ctzll(word)));
+#endif
+}
+
+//------------------------------------------------------------------------| RowSet
+
+class RowSet
+/*------------------------------------------------------------------------------
+desc | . ascending set of row indexes used to restrict attribute queries.
+vars | representation | Range : [0, universe) | Chunks : chunks
+     | chunks : rows by blocks of 65536, each one held by its own container,
+     |   16-bit sorted indexes or a bitmap of up to 1024 words
+nots | . rows must be pushed in ascending order.
+     | . as in roaring bitmaps, a chunk is a bitmap when it takes less memory than
+     |   its sorted indexes, beyond 4096 rows for a full chunk, so dense and sparse
+     |   stretches of the same set are each held compactly. Bitmaps end at the
+     |   last row of their chunk, so small sets are not padded to 8 KB.
+     | . bitmap chunks are intersected and subtracted by the Kernel, sorted ones
+     |   are merged or probed against the other container.
+     | . Id names the rows : sets with the same id hold the same rows. Copies
+     |   keep the id, changing the rows drops it and a new one is drawn on demand.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    enum Representation {Range, Chunks};
+
+    class Iterator
+    {
+    public :
+
+        Iterator(const RowSet *rowset, uint position);
+
+        uint operator*(void) const;
+        Iterator &operator++(void);
+
+        bool operator==(const Iterator &rhs) const;
+        bool operator!=(const Iterator &rhs) const;
+
+    private :
+
+        const RowSet *rowset;
+
+        uint chunk;
+        uint position;
+        uint64_t bits;
+
+    private :
+
+        void Load(void);
+    };
+
+public :
+
+    RowSet(void);
+    RowSet(const std::vector <uint> &indexes);
+    RowSet(std::initializer_list <uint> indexes);
+
+    RowSet(const RowSet &rhs);
+    RowSet(RowSet &&rhs);
+
+    RowSet &operator=(const RowSet &rhs);
+    RowSet &operator=(RowSet &&rhs);
+
+    static RowSet GetRange(uint universe);
+
+    Representation GetRepresentation(void) const;
+
+    uint Size(void) const;
+    uint Universe(void) const;
+    bool IsEmpty(void) const;
+    bool Contains(uint index) const;
+
+    uint64_t Id(void) const;
+    bool HasId(void) const;
+
+    void Clear(void);
+    void PushBack(uint index);
+    void Compact(void);
+
+    RowSet Intersection(const RowSet &rhs) const;
+    uint IntersectionSize(const RowSet &rhs) const;
+    uint IntersectionSize(const uint64_t *bits, uint size) const;
+
+    RowSet Difference(const RowSet &rhs) const;
+    uint DifferenceSize(const RowSet &rhs) const;
+
+    std::vector <uint> ToVector(void) const;
+
+    Iterator begin(void) const;
+    Iterator end(void) const;
+
+private :
+
+    struct Chunk
+    {
+        uint key;
+        uint count;
+
+        std::vector <uint16_t> indexes;
+        std::vector <uint64_t> words;
+    };
+
+    static const uint chunkBits = 16;
+    static const uint chunkWords = 1024;
+    static const uint chunkSorted = 4096;
+
+    Representation representation;
+
+    uint universe;
+    uint count;
+
+    std::vector <Chunk> chunks;
+
+    mutable std::atomic <uint64_t> id;
+
+private :
+
+    const Chunk *Find(uint key) const;
+    uint Rank(uint bound) const;
+    void Trim(void);
+
+    static uint GetSpan(const Chunk &chunk);
+    static bool Test(const Chunk &bitmap, uint low);
+    static void Shrink(Chunk &bitmap);
+
+    static void ToBitmap(Chunk &chunk);
+    static void ToSorted(Chunk &chunk);
+
+    static void Intersect(const Chunk &lhs, const Chunk &rhs, Chunk &chunk);
+    static uint Overlap(const Chunk &lhs, const Chunk &rhs);
+    static void Subtract(const Chunk &lhs, const Chunk &rhs, Chunk &chunk);
+};
+}
+
+#endif // ROWSET_H
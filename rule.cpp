@@ -4,7 +4,7 @@ using namespace ML;
 
 //------------------------------------------------------------------------| Rule
 
-Rule::Factor::Factor(const std::wstring &attribute, MathOp mathop, const Variant &restriction) :
-    attribute(attribute), mathop(mathop), value(restriction) {}
+Rule::Factor::Factor(const std::wstring &attribute, MathOp mathop, const Variant &restriction, uint column) :
+    attribute(attribute), mathop(mathop), value(restriction), column(column) {}
 
 Rule::Rule(const float p) : p(p) {}
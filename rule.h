@@ -15,6 +15,9 @@ class Rule
 public :
 
     struct Factor
+    /*--------------------------------------------------------------------------
+    vars | column : id of attribute in the trained dataframe | -1 : unknown
+    --------------------------------------------------------------------------*/
     {
     public :
 
@@ -22,9 +25,11 @@ public :
         MathOp mathop;
         Variant value;
 
+        uint column;
+
     public :
 
-        Factor(const std::wstring &attribute, MathOp mathop, const Variant &value);
+        Factor(const std::wstring &attribute, MathOp mathop, const Variant &value, uint column = -1);
     };
 
 public :
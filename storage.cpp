@@ -0,0 +1,547 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "storage.h"
+
+using namespace ML;
+
+//------------------------------------------------------------------------| Global
+
+static const char magic[4] = {'M', 'L', 'D', 'F'};
+
+static const uint32_t endianness = 0x01020304;
+
+static const uint64_t alignment = 64;
+
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t endianness;
+    uint32_t columns;
+    uint64_t table;
+    uint64_t size;
+};
+
+struct ColumnEntry
+{
+    uint32_t type;
+    uint32_t flags;
+    uint64_t rows;
+    uint64_t name;
+    uint64_t nameSize;
+    uint64_t cells;
+    uint64_t dictionary;
+    uint64_t dictionarySize;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 32, "unexpected header layout");
+static_assert(sizeof(ColumnEntry) == 64, "unexpected column entry layout");
+
+static void RemoveFile(const std::wstring &path)
+{
+#if defined(_WIN32)
+    _wremove(path.c_str());
+#else
+    std::string narrowPath;
+
+    EncodeUTF8(path, narrowPath);
+
+    remove(narrowPath.c_str());
+#endif
+}
+
+static bool Write(FILE *file, const void *data, uint64_t size, uint64_t &position)
+{
+    if(size && (fwrite(data, 1, size, file) != size)) return(false);
+
+    position += size;
+
+    return(true);
+}
+
+static bool Pad(FILE *file, uint64_t &position, uint64_t boundary = alignment)
+{
+    static const unsigned char zeros[alignment] = {0};
+
+    uint64_t padding = (boundary - (position % boundary)) % boundary;
+
+    return(Write(file, zeros, padding, position));
+}
+
+template <class T> static bool WriteCells(FILE *file, const Cells <T> &cells, ColumnEntry &entry, uint64_t &position)
+{
+    if(!Pad(file, position)) return(false);
+
+    entry.rows = cells.size();
+    entry.cells = position;
+
+    return(Write(file, cells.data(), cells.size() * sizeof(T), position));
+}
+
+static bool WriteBits(FILE *file, const BitCells &cells, ColumnEntry &entry, uint64_t &position)
+{
+    if(!Pad(file, position)) return(false);
+
+    entry.rows = cells.size();
+    entry.cells = position;
+
+    return(Write(file, cells.Words(), cells.WordCount() * sizeof(uint64_t), position));
+}
+
+static bool WriteDictionary(FILE *file, const Dictionary &dictionary, ColumnEntry &entry, uint64_t &position)
+/*------------------------------------------------------------------------------
+nots | . order (uint32 by string), offsets (uint64 by string + 1), strings.
+------------------------------------------------------------------------------*/
+{
+    uint64_t n = dictionary.Size();
+
+    std::vector <uint32_t> order(dictionary.order.begin(), dictionary.order.end());
+    std::vector <uint64_t> offsets(1, 0);
+
+    std::string strings, string;
+
+    for(uint code = 0; code < n; ++code)
+    {
+        EncodeUTF8(dictionary.GetValue(code), string);
+
+        strings += string;
+        offsets.push_back(strings.size());
+    }
+
+    if(!Pad(file, position)) return(false);
+
+    entry.dictionary = position;
+    entry.dictionarySize = n;
+
+    return(Write(file, order.data(), n * sizeof(uint32_t), position) && Pad(file, position, 8) &&
+           Write(file, offsets.data(), (n + 1) * sizeof(uint64_t), position) &&
+           Write(file, strings.data(), strings.size(), position));
+}
+
+template <class T> static bool BorrowCells(const MappedFile &file, const ColumnEntry &entry,
+    const std::shared_ptr<const void> &holder, Cells <T> &cells)
+{
+    uint64_t size = file.Size();
+
+    if((entry.cells > size) || (entry.rows > (size - entry.cells) / sizeof(T))) return(false);
+    if(entry.cells % sizeof(T)) return(false);
+
+    cells.Borrow(reinterpret_cast<const T *>(file.Data() + entry.cells), entry.rows, holder);
+
+    return(true);
+}
+
+static bool BorrowBits(const MappedFile &file, const ColumnEntry &entry,
+    const std::shared_ptr<const void> &holder, BitCells &cells)
+/*------------------------------------------------------------------------------
+nots | . bits past the last row must be zero.
+------------------------------------------------------------------------------*/
+{
+    uint64_t size = file.Size();
+    uint64_t words = (entry.rows >> 6) + ((entry.rows & 63) ? 1 : 0);
+
+    if((entry.cells > size) || (words > (size - entry.cells) / sizeof(uint64_t))) return(false);
+    if(entry.cells % sizeof(uint64_t)) return(false);
+
+    const uint64_t *bits = reinterpret_cast<const uint64_t *>(file.Data() + entry.cells);
+
+    if((entry.rows & 63) && (bits[words - 1] >> (entry.rows & 63))) return(false);
+
+    cells.Borrow(bits, entry.rows, holder);
+
+    return(true);
+}
+
+static bool ReadBytes(const MappedFile &file, const ColumnEntry &entry, BitCells &cells)
+/*------------------------------------------------------------------------------
+desc | . bools of version 1 files, one byte per bool, copied into bits.
+nots | . a byte other than 0 or 1 is not a valid bool.
+------------------------------------------------------------------------------*/
+{
+    uint64_t size = file.Size();
+
+    if((entry.cells > size) || (entry.rows > size - entry.cells)) return(false);
+
+    const unsigned char *bytes = file.Data() + entry.cells;
+
+    cells.reserve(entry.rows);
+
+    for(uint64_t row = 0; row < entry.rows; ++row)
+    {
+        if(bytes[row] > 1) return(false);
+
+        cells.push_back(bytes[row] != 0);
+    }
+
+    return(true);
+}
+
+static bool ReadDictionary(const MappedFile &file, const ColumnEntry &entry, Dictionary &dictionary)
+{
+    const unsigned char *data = file.Data();
+
+    uint64_t size = file.Size();
+    uint64_t n = entry.dictionarySize;
+
+    if((entry.dictionary > size) || (n > (size - entry.dictionary) / 12)) return(false);
+
+    uint64_t offsets = entry.dictionary + n * sizeof(uint32_t);
+
+    offsets += (8 - (offsets % 8)) % 8;
+
+    if((offsets > size) || (n + 1 > (size - offsets) / sizeof(uint64_t))) return(false);
+
+    uint64_t strings = offsets + (n + 1) * sizeof(uint64_t);
+
+    std::vector <uint32_t> order32(n);
+    std::vector <uint64_t> offset(n + 1);
+
+    memcpy(order32.data(), data + entry.dictionary, n * sizeof(uint32_t));
+    memcpy(offset.data(), data + offsets, (n + 1) * sizeof(uint64_t));
+
+    std::vector <std::wstring> values(n);
+    std::vector <uint> order(order32.begin(), order32.end());
+
+    for(uint64_t code = 0; code < n; ++code)
+    {
+        if((offset[code] > offset[code + 1]) || (offset[code + 1] > size - strings)) return(false);
+        if(!DecodeUTF8(data + strings + offset[code], offset[code + 1] - offset[code], values[code])) return(false);
+    }
+
+    std::vector <bool> seen(n, false);
+
+    for(uint64_t i = 0; i < n; ++i)
+    {
+        if((order[i] >= n) || seen[order[i]]) return(false);
+
+        seen[order[i]] = true;
+    }
+
+    dictionary.Assign(values, order);
+
+    return(true);
+}
+
+//------------------------------------------------------------------------| MappedFile
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(void) : data(nullptr), size(0), file(INVALID_HANDLE_VALUE), mapping(nullptr) {}
+
+bool MappedFile::Open(const std::wstring &path)
+{
+    Close();
+
+    file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if(file == INVALID_HANDLE_VALUE) return(false);
+
+    LARGE_INTEGER length;
+
+    if(!GetFileSizeEx(file, &length) || (length.QuadPart == 0))
+    {
+        Close();
+        return(false);
+    }
+
+    mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if(mapping) data = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+    if(!data)
+    {
+        Close();
+        return(false);
+    }
+
+    size = length.QuadPart;
+
+    return(true);
+}
+
+void MappedFile::Close(void)
+{
+    if(data) UnmapViewOfFile(data);
+    if(mapping) CloseHandle(mapping);
+    if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+
+    data = nullptr;
+    size = 0;
+    file = INVALID_HANDLE_VALUE;
+    mapping = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(void) : data(nullptr), size(0) {}
+
+bool MappedFile::Open(const std::wstring &path)
+{
+    Close();
+
+    std::string narrowPath;
+
+    EncodeUTF8(path, narrowPath);
+
+    int file = open(narrowPath.c_str(), O_RDONLY);
+
+    if(file < 0) return(false);
+
+    struct stat status;
+
+    if((fstat(file, &status) != 0) || (status.st_size <= 0))
+    {
+        close(file);
+        return(false);
+    }
+
+    void *pages = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+
+    close(file);
+
+    if(pages == MAP_FAILED) return(false);
+
+    data = static_cast<const unsigned char *>(pages);
+    size = status.st_size;
+
+    return(true);
+}
+
+void MappedFile::Close(void)
+{
+    if(data) munmap(const_cast<unsigned char *>(data), size);
+
+    data = nullptr;
+    size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile(void)
+{
+    Close();
+}
+
+const unsigned char *MappedFile::Data(void) const {return(data);}
+
+uint64_t MappedFile::Size(void) const {return(size);}
+
+//------------------------------------------------------------------------| Storage
+
+bool Storage::Save(DataFrame &dataframe, const std::wstring &path)
+/*------------------------------------------------------------------------------
+nots | . fails on columns of generic type.
+------------------------------------------------------------------------------*/
+{
+    FILE *file = OpenFile(path, L"wb");
+
+    if(!file) return(false);
+
+    uint columns = dataframe.attributes.size();
+
+    FileHeader header;
+    std::vector <ColumnEntry> table(columns);
+
+    memset(&header, 0, sizeof(header));
+    memset(table.data(), 0, columns * sizeof(ColumnEntry));
+
+    uint64_t position = 0;
+
+    bool success = Write(file, &header, sizeof(header), position) &&
+                   Write(file, table.data(), columns * sizeof(ColumnEntry), position);
+
+    for(uint i = 0; success && (i < columns); ++i)
+    {
+        Attribute *attribute = dataframe.attributes[i];
+        ColumnEntry &entry = table[i];
+
+        std::string name;
+
+        EncodeUTF8(attribute->name, name);
+
+        entry.type = dataframe.GetColumnType(i);
+        entry.flags = attribute->discrete ? 1 : 0;
+        entry.name = position;
+        entry.nameSize = name.size();
+
+        success = Write(file, name.data(), name.size(), position);
+
+        if(!success) break;
+
+        switch(entry.type)
+        {
+        case DataFrame::BoolType :
+            success = WriteBits(file, static_cast<BoolAttribute *>(attribute)->cells, entry, position);
+            break;
+        case DataFrame::IntType :
+            success = WriteCells<int>(file, static_cast<IntAttribute *>(attribute)->cells, entry, position);
+            break;
+        case DataFrame::FloatType :
+            success = WriteCells<float>(file, static_cast<FloaAttribute *>(attribute)->cells, entry, position);
+            break;
+        case DataFrame::WStringType :
+        {
+            WStringAttribute *wstringAttribute = static_cast<WStringAttribute *>(attribute);
+
+            success = WriteCells<uint>(file, wstringAttribute->cells, entry, position) &&
+                      WriteDictionary(file, wstringAttribute->dictionary, entry, position);
+            break;
+        }
+        default :
+            success = false;
+        }
+    }
+
+    memcpy(header.magic, magic, sizeof(magic));
+
+    header.version = version;
+    header.endianness = endianness;
+    header.columns = columns;
+    header.table = sizeof(header);
+    header.size = position;
+
+    uint64_t start = 0;
+
+    success = success && (fseek(file, 0, SEEK_SET) == 0) &&
+              Write(file, &header, sizeof(header), start) &&
+              Write(file, table.data(), columns * sizeof(ColumnEntry), start);
+
+    success = (fclose(file) == 0) && success;
+
+    if(!success) RemoveFile(path);
+
+    return(success);
+}
+
+bool Storage::Load(DataFrame &dataframe, const std::wstring &path)
+/*------------------------------------------------------------------------------
+desc | . replaces the columns of dataframe with the columns stored in path.
+nots | . the file is fully validated first, dataframe is untouched on failure.
+------------------------------------------------------------------------------*/
+{
+    std::shared_ptr<MappedFile> file(new MappedFile());
+
+    if(!file->Open(path)) return(false);
+
+    const unsigned char *data = file->Data();
+    uint64_t size = file->Size();
+
+    FileHeader header;
+
+    if(size < sizeof(header)) return(false);
+
+    memcpy(&header, data, sizeof(header));
+
+    if(memcmp(header.magic, magic, sizeof(magic)) != 0) return(false);
+    if((header.version == 0) || (header.version > version)) return(false);
+    if((header.endianness != endianness) || (header.size != size)) return(false);
+    if((header.table > size) || (header.columns > (size - header.table) / sizeof(ColumnEntry))) return(false);
+
+    std::vector <ColumnEntry> table(header.columns);
+
+    memcpy(table.data(), data + header.table, header.columns * sizeof(ColumnEntry));
+
+    std::shared_ptr<const void> holder(file, file.get());
+
+    std::vector <Attribute *> attributes;
+
+    bool success = true;
+
+    for(uint i = 0; success && (i < header.columns); ++i)
+    {
+        const ColumnEntry &entry = table[i];
+
+        std::wstring name;
+
+        if((entry.name > size) || (entry.nameSize > size - entry.name) ||
+           !DecodeUTF8(data + entry.name, entry.nameSize, name))
+        {
+            success = false;
+            break;
+        }
+
+        Attribute *attribute = nullptr;
+
+        switch(entry.type)
+        {
+        case DataFrame::BoolType :
+        {
+            BoolAttribute *boolAttribute = new BoolAttribute(name);
+
+            if(header.version < 2)
+                success = ReadBytes(*file, entry, boolAttribute->cells);
+            else
+                success = BorrowBits(*file, entry, holder, boolAttribute->cells);
+
+            attribute = boolAttribute;
+            break;
+        }
+        case DataFrame::IntType :
+        {
+            IntAttribute *intAttribute = new IntAttribute(name);
+
+            success = BorrowCells<int>(*file, entry, holder, intAttribute->cells);
+
+            attribute = intAttribute;
+            break;
+        }
+        case DataFrame::FloatType :
+        {
+            FloaAttribute *floatAttribute = new FloaAttribute(name);
+
+            success = BorrowCells<float>(*file, entry, holder, floatAttribute->cells);
+
+            attribute = floatAttribute;
+            break;
+        }
+        case DataFrame::WStringType :
+        {
+            WStringAttribute *wstringAttribute = new WStringAttribute(name);
+
+            success = BorrowCells<uint>(*file, entry, holder, wstringAttribute->cells) &&
+                      ReadDictionary(*file, entry, wstringAttribute->dictionary);
+
+            for(uint64_t row = 0; success && (row < entry.rows); ++row)
+                success = (wstringAttribute->cells[row] < entry.dictionarySize);
+
+            attribute = wstringAttribute;
+            break;
+        }
+        default :
+            success = false;
+        }
+
+        if(attribute)
+        {
+            attribute->discrete = (entry.flags & 1) != 0;
+            attributes.push_back(attribute);
+        }
+    }
+
+    if(!success)
+    {
+        clrptrvector<Attribute *>(attributes);
+        return(false);
+    }
+
+    dataframe.Clear();
+    dataframe.attributes = attributes;
+
+    return(true);
+}
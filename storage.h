@@ -0,0 +1,76 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+------------------------------------------------------------------------------*/
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <string>
+#include <memory>
+#include <stdint.h>
+
+#include "core.h"
+
+namespace ML
+{
+//------------------------------------------------------------------------| MappedFile
+
+class MappedFile
+/*------------------------------------------------------------------------------
+desc | . read only mapping of a whole file.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    MappedFile(void);
+    ~MappedFile(void);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool Open(const std::wstring &path);
+    void Close(void);
+
+    const unsigned char *Data(void) const;
+    uint64_t Size(void) const;
+
+private :
+
+    const unsigned char *data;
+    uint64_t size;
+
+#if defined(_WIN32)
+    void *file;
+    void *mapping;
+#endif
+};
+
+//------------------------------------------------------------------------| Storage
+
+class Storage
+/*------------------------------------------------------------------------------
+desc | . versioned binary columnar files of dataframes.
+vars | version : format written by Save, Load rejects newer ones
+nots | . header | magic "MLDF", version, endianness mark, columns, table offset, size
+     | . table | one entry per column : type, flags (1 : discrete), rows, name,
+     |   cells and dictionary offsets, dictionary size
+     | . cells are stored as in memory, 64 byte aligned, bools packed 64 to a word.
+     | . version 1 stored a byte per bool, those bools are copied on load.
+     | . dictionaries hold the sorted order, the string offsets and the strings.
+     | . names and strings are UTF-8.
+     | . loaded columns borrow their cells from the mapped file, which stays
+     |   mapped while any of them is alive. Strings are decoded on load.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    static const uint32_t version = 2;
+
+public :
+
+    static bool Save(DataFrame &dataframe, const std::wstring &path);
+    static bool Load(DataFrame &dataframe, const std::wstring &path);
+};
+}
+
+#endif // STORAGE_H
@@ -0,0 +1,246 @@
+/*------------------------------------------------------------------------------
+auth | Roberto Peribáñez Iglesias (ergocortex) 2018
+desc | . checks that every Kernel level the CPU supports gives the same bits as
+     |   Scalar on random tables, and that fused reductions are within tolerance.
+nots | . build and run from the repository root :
+     |   g++ -std=c++11 -O2 -I. test/kernel.cpp kernel.cpp -o kernel_test && ./kernel_test
+     | . exits with 1 on the first mismatch.
+------------------------------------------------------------------------------*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+
+#include "kernel.h"
+
+using namespace ML;
+
+//------------------------------------------------------------------------| Global
+
+static uint64_t state = 0x2545F4914F6CDD1Dull;
+
+static uint64_t Random(void)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    return(state);
+}
+
+static const char *names[] = {"Scalar", "SSE42", "AVX2", "AVX512"};
+
+static uint failures = 0;
+
+static void Check(bool equal, const char *kernel, Kernel::Level level, uint size)
+{
+    if(equal) return;
+
+    printf("%s differs from Scalar at %s, size %u\n", kernel, names[level], size);
+
+    ++failures;
+}
+
+//------------------------------------------------------------------------| Tests
+
+static void TestCount(Kernel::Level level)
+/*------------------------------------------------------------------------------
+nots | . sizes cross the vector widths, the 256 rows block and the threshold of
+     |   the interleaved sub-histograms (n >= 1024, n >= 8 * V * K, V * K <= 4096).
+------------------------------------------------------------------------------*/
+{
+    const uint sizes[] = {0, 1, 3, 7, 15, 17, 33, 255, 256, 257, 1023, 1024, 1025, 4099, 40000};
+    const uint shapes[][2] = {{1, 1}, {2, 2}, {3, 5}, {16, 8}, {64, 64}, {65, 64}, {128, 3}};
+
+    for(uint n : sizes)
+    {
+        for(const uint *shape : shapes)
+        {
+            uint V = shape[0];
+            uint K = shape[1];
+
+            std::vector <uint> values(n);
+            std::vector <uint> classes(n);
+
+            for(uint i = 0; i < n; ++i)
+            {
+                values[i] = Random() % V;
+                classes[i] = Random() % K;
+            }
+
+            std::vector <int> expected(V * K, 0);
+            std::vector <int> counts(V * K, 0);
+
+            Kernel::SetLevel(Kernel::Scalar);
+            Kernel::Count(values.data(), V, classes.data(), K, n, expected.data());
+
+            Kernel::SetLevel(level);
+            Kernel::Count(values.data(), V, classes.data(), K, n, counts.data());
+
+            Check(counts == expected, "Count", level, n);
+        }
+    }
+}
+
+static void TestProportions(Kernel::Level level)
+/*------------------------------------------------------------------------------
+nots | . tables below 8 classes always run in Scalar, the rest cross the widths
+     |   and the 256 classes block. Some counts are 0 on purpose.
+------------------------------------------------------------------------------*/
+{
+    const uint sizes[] = {1, 7, 8, 9, 15, 16, 17, 31, 33, 255, 256, 257, 1000};
+
+    for(uint K : sizes)
+    {
+        std::vector <int> counts(K);
+
+        int N = 0;
+
+        for(uint i = 0; i < K; ++i)
+        {
+            counts[i] = (Random() % 4) ? (int)(Random() % 1000) : 0;
+            N += counts[i];
+        }
+
+        if(!N) N = 1;
+
+        Kernel::SetLevel(Kernel::Scalar);
+
+        float entropy = Kernel::Entropy(counts.data(), K, (float)(N));
+        float gini = Kernel::Gini(counts.data(), K, (float)(N));
+
+        Kernel::SetLevel(level);
+
+        float vectorEntropy = Kernel::Entropy(counts.data(), K, (float)(N));
+        float vectorGini = Kernel::Gini(counts.data(), K, (float)(N));
+
+        Check(!memcmp(&entropy, &vectorEntropy, sizeof(float)), "Entropy", level, K);
+        Check(!memcmp(&gini, &vectorGini, sizeof(float)), "Gini", level, K);
+    }
+}
+
+static void TestFused(Kernel::Level level)
+/*------------------------------------------------------------------------------
+nots | . fused reductions are not bit exact, they are checked against values
+     |   computed in double, as are the sequential sums of Scalar, which drift
+     |   further with thousands of classes.
+     | . counts run from single classes to 4096 classes of skewed sizes.
+------------------------------------------------------------------------------*/
+{
+    const double tolerance = 1e-5;
+
+    const uint sizes[] = {1, 2, 3, 4, 5, 8, 15, 16, 17, 31, 64, 100, 255, 256, 257, 1000, 4096};
+
+    Kernel::SetLevel(level);
+
+    for(uint K : sizes)
+    {
+        for(uint round = 0; round < 20; ++round)
+        {
+            std::vector <int> counts(K);
+
+            int N = 0;
+
+            for(uint i = 0; i < K; ++i)
+            {
+                counts[i] = (Random() % 4) ? (int)(Random() % ((round % 2) ? 100000 : 10)) : 0;
+                N += counts[i];
+            }
+
+            if(!N) N = 1;
+
+            double entropy = 0.0;
+            double gini = 1.0;
+
+            for(uint i = 0; i < K; ++i)
+            {
+                if(!counts[i]) continue;
+
+                double p = (double)(counts[i])/(double)(N);
+
+                entropy -= p * log2(p);
+                gini -= p * p;
+            }
+
+            Kernel::SetFused(true);
+
+            float fusedEntropy = Kernel::Entropy(counts.data(), K, (float)(N));
+            float fusedGini = Kernel::Gini(counts.data(), K, (float)(N));
+
+            Kernel::SetFused(false);
+
+            Check(fabs(fusedEntropy - entropy) <= tolerance * std::max(1.0, entropy), "fused Entropy", level, K);
+            Check(fabs(fusedGini - gini) <= tolerance, "fused Gini", level, K);
+        }
+    }
+}
+
+static void TestBitmaps(Kernel::Level level)
+{
+    for(uint n = 0; n <= 70; ++n)
+    {
+        std::vector <uint64_t> lhs(n);
+        std::vector <uint64_t> rhs(n);
+
+        for(uint i = 0; i < n; ++i)
+        {
+            lhs[i] = Random();
+            rhs[i] = (i % 5) ? Random() : ~lhs[i];
+        }
+
+        std::vector <uint64_t> expected(n);
+        std::vector <uint64_t> words(n);
+
+        Kernel::SetLevel(Kernel::Scalar);
+
+        uint both = Kernel::And(lhs.data(), rhs.data(), n, expected.data());
+
+        Kernel::SetLevel(level);
+
+        Check(Kernel::And(lhs.data(), rhs.data(), n, words.data()) == both, "And", level, n);
+        Check(words == expected, "And", level, n);
+        Check(Kernel::And(lhs.data(), rhs.data(), n) == both, "And", level, n);
+
+        Kernel::SetLevel(Kernel::Scalar);
+
+        uint only = Kernel::AndNot(lhs.data(), rhs.data(), n, expected.data());
+
+        Kernel::SetLevel(level);
+
+        Check(Kernel::AndNot(lhs.data(), rhs.data(), n, words.data()) == only, "AndNot", level, n);
+        Check(words == expected, "AndNot", level, n);
+        Check(Kernel::AndNot(lhs.data(), rhs.data(), n) == only, "AndNot", level, n);
+    }
+}
+
+//------------------------------------------------------------------------| Main
+
+int main(void)
+{
+    const Kernel::Level levels[] = {Kernel::SSE42, Kernel::AVX2, Kernel::AVX512};
+
+    for(Kernel::Level level : levels)
+    {
+        Kernel::SetLevel(level);
+
+        if(Kernel::GetLevel() != level)
+        {
+            printf("%s not supported, skipped\n", names[level]);
+            continue;
+        }
+
+        TestCount(level);
+        TestProportions(level);
+        TestFused(level);
+        TestBitmaps(level);
+
+        printf("%s checked\n", names[level]);
+    }
+
+    printf(failures ? "FAILED\n" : "OK\n");
+
+    return(failures ? 1 : 0);
+}
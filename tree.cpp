@@ -6,144 +6,940 @@ auth | Roberto Peribáñez Iglesias (ergocortex) 2018
 
 using namespace ML;
 
+//------------------------------------------------------------------------| Global
+
+template <class T> static inline bool ValidateValue(T a, MathOp mathop, T b)
+{
+    switch(mathop)
+    {
+    case 0 : return(a == b);
+    case 1 : return(a < b);
+    case 2 : return(a <= b);
+    case 3 : return(a >= b);
+    case 4 : return(a > b);
+    }
+
+    return(false);
+}
+
 //------------------------------------------------------------------------| Node
 
-Node::Node(void) : leaf(false) {}
+Node::Node(void) : leaf(false), column(-1) {}
 
-Node::Node(Variant data, bool leaf) : data(data), leaf(leaf)  {}
+Node::Node(Variant data, bool leaf) : data(data), leaf(leaf), column(-1)  {}
 
 //------------------------------------------------------------------------| Edge
 
 Edge::Edge(const Variant &data, float p, MathOp mathop, Node *source, Node *target) :
-    source(source), target(target), data(data), mathop(mathop), p(p)  {}
+    source(source), target(target), column(source ? source->column : -1), data(data), mathop(mathop), p(p)  {}
+
+//------------------------------------------------------------------------| Fragment
+
+Node *Fragment::AddNode(void)
+{
+    Node *node = nodeArena.New();
+
+    nodes.push_back(node);
+
+    return(node);
+}
+
+Edge *Fragment::AddEdge(const Variant &data, float p, MathOp mathop, Node *source, Node *target)
+{
+    Edge *edge = edgeArena.New(data, p, mathop, source, target);
+
+    edges.push_back(edge);
+
+    return(edge);
+}
+
+void Fragment::Append(Fragment &fragment)
+{
+    nodes.insert(nodes.end(), fragment.nodes.begin(), fragment.nodes.end());
+    edges.insert(edges.end(), fragment.edges.begin(), fragment.edges.end());
+
+    fragment.nodes.clear();
+    fragment.edges.clear();
+
+    nodeArena.Splice(fragment.nodeArena);
+    edgeArena.Splice(fragment.edgeArena);
+}
+
+//------------------------------------------------------------------------| ContingencyTable
+
+ContingencyTable::ContingencyTable(const std::vector <uint> &valueCodes, uint values,
+    const std::vector <uint> &classCodes, uint classes) : values(values), classes(classes),
+    N(valueCodes.size()), counts(values * classes, 0), valueCounts(values, 0), classCounts(classes, 0)
+{
+    Kernel::Count(valueCodes.data(), values, classCodes.data(), classes, valueCodes.size(), counts.data());
+
+    for(uint value = 0; value < values; ++value)
+    {
+        for(uint classe = 0; classe < classes; ++classe)
+        {
+            valueCounts[value] += counts[value * classes + classe];
+            classCounts[classe] += counts[value * classes + classe];
+        }
+    }
+}
+
+ContingencyTable::ContingencyTable(uint values, uint classes, float N) : values(values), classes(classes),
+    N(N), counts(values * classes, 0), valueCounts(values, 0), classCounts(classes, 0) {}
+
+float ContingencyTable::GetEntropy(void) const
+{
+    return(classes ? GetEntropy(&classCounts[0]) : 0.0f);
+}
+
+float ContingencyTable::GetEntropy(uint value) const
+/*------------------------------------------------------------------------------
+nots | . an empty value does not restrict, as an empty restriction.
+------------------------------------------------------------------------------*/
+{
+    if(!valueCounts[value]) return(GetEntropy());
+
+    return(GetEntropy(&counts[value * classes]));
+}
+
+float ContingencyTable::GetGiniIndex(void) const
+{
+    return(classes ? GetGiniIndex(&classCounts[0]) : 1.0f);
+}
+
+float ContingencyTable::GetGiniIndex(uint value) const
+{
+    if(!valueCounts[value]) return(GetGiniIndex());
+
+    return(GetGiniIndex(&counts[value * classes]));
+}
+
+float ContingencyTable::GetEntropy(const int *frecuency) const
+{
+    return(Kernel::Entropy(frecuency, classes, N));
+}
+
+float ContingencyTable::GetGiniIndex(const int *frecuency) const
+{
+    return(Kernel::Gini(frecuency, classes, N));
+}
+
+//------------------------------------------------------------------------| Binning
+
+Binning::Binning(void) : classes(0) {}
+
+void Binning::Build(const DataFrameView &view, uint bins)
+/*------------------------------------------------------------------------------
+nots | . a value is in bin b if it is not lower than thresholds[b - 1] and lower
+     |   than thresholds[b], thresholds are distinct and above the minimum.
+     | . thresholds are quantiles of the rows of the view only, so rows held out
+     |   of training do not shape them. Other rows of the dataframe get code 0.
+------------------------------------------------------------------------------*/
+{
+    Clear();
+
+    DataFrame &dataframe = *view.dataframe;
+
+    std::vector <Attribute *> &attributes = dataframe.attributes;
+
+    if(attributes.empty()) return;
+
+    uint n = attributes.size();
+
+    if(bins > maxBins) bins = maxBins;
+
+    thresholds.resize(n);
+    codes.resize(n);
+
+    std::vector <uint> viewCodes;
+
+    classes = attributes.back()->GetCodes(view, viewCodes);
+
+    classCodes.assign(dataframe.Size(), 0);
+
+    uint i = 0;
+
+    for(uint row : view.rows)
+        classCodes[row] = viewCodes[i++];
+
+    if(bins < 2) return;
+
+    std::vector <uint> order;
+
+    for(uint column = 0; column < n - 1; ++column)
+    {
+        if(!attributes[column]->GetSortedRows(view, order) || order.empty()) continue;
+
+        uint N = order.size();
+
+        std::vector <Variant> values;
+
+        values.reserve(N);
+
+        for(uint row : order)
+            values.push_back(attributes[column]->GetCell(row));
+
+        std::vector <Variant> &cuts = thresholds[column];
+
+        for(uint b = 1; b < bins; ++b)
+        {
+            const Variant &value = values[(uint64_t)(b) * N / bins];
+
+            if((values.front() < value) && (cuts.empty() || (cuts.back() < value)))
+                cuts.push_back(value);
+        }
+
+        if(cuts.empty()) continue;
+
+        codes[column].resize(dataframe.Size(), 0);
+
+        uint bin = 0;
+
+        for(uint i = 0; i < N; ++i)
+        {
+            while((bin < cuts.size()) && !(values[i] < cuts[bin])) ++bin;
+
+            codes[column][order[i]] = bin;
+        }
+    }
+}
+
+void Binning::Clear(void)
+{
+    thresholds.clear();
+    codes.clear();
+    classCodes.clear();
+
+    classes = 0;
+}
+
+bool Binning::IsBuilt(void) const
+{
+    return(!codes.empty());
+}
+
+bool Binning::IsBinned(uint column) const
+{
+    return((column < thresholds.size()) && !thresholds[column].empty());
+}
+
+std::vector<Attribute::ProbabilityDistribution> *Binning::GetProbabilityDistribution(
+    const DataFrameView &view, uint column, uint boundary) const
+/*------------------------------------------------------------------------------
+desc | . rows of the view below and above thresholds[column][boundary], as the
+     |   distribution of a continuous attribute splits them at its median.
+------------------------------------------------------------------------------*/
+{
+    std::vector <Attribute::ProbabilityDistribution> *probabilityDistribution =
+        new std::vector <Attribute::ProbabilityDistribution>;
+
+    const Variant &threshold = thresholds[column][boundary];
+    const std::vector <ubyte> &bins = codes[column];
+
+    uint N = view.Size();
+    uint p = 0;
+
+    for(uint i : view.rows)
+    {
+        if(bins[i] <= boundary) ++p;
+    }
+
+    probabilityDistribution->push_back(Attribute::ProbabilityDistribution(threshold, (float)(p)/(float)(N), 1));
+    probabilityDistribution->push_back(Attribute::ProbabilityDistribution(threshold, (float)(N - p)/(float)(N), 3));
+
+    for(uint i : view.rows)
+        (*probabilityDistribution)[(bins[i] <= boundary) ? 0 : 1].indexes.PushBack(i);
+
+    for(Attribute::ProbabilityDistribution &distribution : *probabilityDistribution)
+    {
+        distribution.indexes.Compact();
+        distribution.indexes.Id();
+    }
+
+    return(probabilityDistribution);
+}
+
+//------------------------------------------------------------------------| Histogram
+
+Histogram::Histogram(const Binning *binning) : binning(binning) {}
+
+void Histogram::Accumulate(const DataFrameView &view, const std::vector <uint> &columns)
+{
+    uint K = binning->classes;
+
+    counts.assign(binning->codes.size(), std::vector <int>());
+
+    for(uint column : columns)
+    {
+        if(!binning->IsBinned(column)) continue;
+
+        const std::vector <ubyte> &bins = binning->codes[column];
+
+        std::vector <int> &histogram = counts[column];
+
+        histogram.assign((binning->thresholds[column].size() + 1) * K, 0);
+
+        for(uint i : view.rows)
+            ++histogram[bins[i] * K + binning->classCodes[i]];
+    }
+}
+
+std::vector <Histogram> Histogram::Divide(const std::vector <DataFrameView> &subviews,
+    const std::vector <uint> &columns) const
+{
+    std::vector <Histogram> histograms(subviews.size(), Histogram(binning));
+
+    if(subviews.empty()) return(histograms);
+
+    uint largest = 0;
+
+    for(uint i = 1, n = subviews.size(); i < n; ++i)
+    {
+        if(subviews[i].Size() > subviews[largest].Size())
+            largest = i;
+    }
+
+    for(uint i = 0, n = subviews.size(); i < n; ++i)
+    {
+        if(i != largest) histograms[i].Accumulate(subviews[i], columns);
+    }
+
+    Histogram &rest = histograms[largest];
+
+    rest.counts.assign(counts.size(), std::vector <int>());
+
+    for(uint column : columns)
+    {
+        if(!IsCounted(column)) continue;
+
+        rest.counts[column] = counts[column];
+
+        for(uint i = 0, n = subviews.size(); i < n; ++i)
+        {
+            if(i == largest) continue;
+
+            const std::vector <int> &sibling = histograms[i].counts[column];
+
+            for(uint j = 0, m = sibling.size(); j < m; ++j)
+                rest.counts[column][j] -= sibling[j];
+        }
+    }
+
+    return(histograms);
+}
+
+bool Histogram::IsCounted(uint column) const
+{
+    return((column < counts.size()) && !counts[column].empty());
+}
 
 //------------------------------------------------------------------------| AttributeSelection
 
+float AttributeSelection::Split::GetScore(const ubyte criterion) const
+{
+    switch(criterion)
+    {
+    case 0 : return(informationGain);
+    case 1 : return(giniImpurity);
+    case 2 : return(proportionGain);
+    }
+
+    return(0.0f);
+}
+
+bool AttributeSelection::Split::IsBetter(const Split &rhs, const ubyte criterion) const
+{
+    if(criterion == 1) return(GetScore(criterion) < rhs.GetScore(criterion));
+
+    return(GetScore(criterion) > rhs.GetScore(criterion));
+}
+
 std::wstring AttributeSelection::InformationGain(DataFrame &subsamples,
     std::vector<std::wstring> &subattributes, const ubyte classes)
+{
+    DataFrameView view(&subsamples);
+
+    return(InformationGain(view, subattributes, classes));
+}
+
+std::wstring AttributeSelection::InformationGain(DataFrameView &subsamples,
+    std::vector<std::wstring> &subattributes, const ubyte classes, ThreadPool *pool)
 /*------------------------------------------------------------------------------
 nots | . information gain is greater the less homogeneity an attribute has.
 ------------------------------------------------------------------------------*/
 {
-    std::map <std::wstring, float> informationGain;
+    return(Select(subsamples, subattributes, 0, classes, pool));
+}
+
+std::wstring AttributeSelection::GiniImpurity(DataFrame &subsamples,
+    std::vector<std::wstring> &subattributes, const ubyte classes)
+{
+    DataFrameView view(&subsamples);
+
+    return(GiniImpurity(view, subattributes, classes));
+}
+
+std::wstring AttributeSelection::GiniImpurity(DataFrameView &subsamples,
+    std::vector<std::wstring> &subattributes, const ubyte classes, ThreadPool *pool)
+/*------------------------------------------------------------------------------
+nots | . source : https://www.researchgate.net/post/How_to_compute_impurity_using_Gini_Index
+------------------------------------------------------------------------------*/
+{
+    return(Select(subsamples, subattributes, 1, classes, pool));
+}
+
+std::wstring AttributeSelection::ProportionGain(DataFrame &subsamples,
+    std::vector<std::wstring> &subattributes, const ubyte classes)
+{
+    DataFrameView view(&subsamples);
+
+    return(ProportionGain(view, subattributes, classes));
+}
+
+std::wstring AttributeSelection::ProportionGain(DataFrameView &subsamples,
+    std::vector<std::wstring> &subattributes, const ubyte classes, ThreadPool *pool)
+{
+    return(Select(subsamples, subattributes, 2, classes, pool));
+}
+
+std::wstring AttributeSelection::Select(DataFrameView &subsamples, std::vector<std::wstring> &subattributes,
+    const ubyte criterion, const ubyte classes, ThreadPool *pool)
+{
+    std::vector <Attribute *> &attributes = subsamples.dataframe->attributes;
+
+    std::vector <uint> subcolumns;
+
+    for(const std::wstring &attribute : subattributes)
+    {
+        uint column = subsamples.dataframe->GetColumnByAttribute(attribute);
+
+        if(column < attributes.size()) subcolumns.push_back(column);
+    }
+
+    uint column = SelectColumn(subsamples, subcolumns, criterion, classes, pool);
+
+    if(column == (uint)-1) return(L"");
+
+    return(attributes[column]->name);
+}
+
+uint AttributeSelection::SelectColumn(DataFrameView &subsamples, const std::vector <uint> &subcolumns,
+    const ubyte criterion, const ubyte classes, ThreadPool *pool, const Histogram *histogram, Split *selected)
+/*------------------------------------------------------------------------------
+desc | . column of the best candidate, -1 if there is none to score.
+nots | . class codes are computed once per node and shared by every attribute.
+     | . gini impurity is minimized, information and proportion gain maximized.
+     | . scores are reduced in attribute name order whether or not they were
+     |   computed concurrently, so ties resolve the same way.
+     | . the last classes columns are never candidates.
+------------------------------------------------------------------------------*/
+{
+    std::map <std::wstring, float> scores;
+
+    std::vector <Attribute *> &attributes = subsamples.dataframe->attributes;
+
+    std::vector <uint> classCodes;
+
+    uint K = attributes.back()->GetCodes(subsamples, classCodes);
+
+    std::vector <uint> candidates;
+
+    for(uint column : subcolumns)
+    {
+        if(column < attributes.size() - classes)
+            candidates.push_back(column);
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    if(candidates.empty()) return(-1);
+
+    std::vector <Split> splits(candidates.size());
+
+    ParallelFor(pool, candidates.size(), [&](uint k)
+    {
+        if(histogram && histogram->IsCounted(candidates[k]))
+            splits[k] = Evaluate(*histogram, candidates[k], subsamples.Size(), criterion);
+
+        if(splits[k].boundary == (uint)-1)
+            splits[k] = Evaluate(subsamples, attributes[candidates[k]], classCodes, K);
+    });
+
+    for(uint k = 0, n = candidates.size(); k < n; ++k)
+        scores.insert(std::pair<std::wstring, float>(attributes[candidates[k]]->name, splits[k].GetScore(criterion)));
+
+    auto it = scores.begin();
+    int best = (criterion == 1) ? ML::FrecuencyMin<std::wstring, float>(scores) :
+                                  ML::FrecuencyMax<std::wstring, float>(scores);
+    std::advance(it, best);
+
+    for(uint k = 0, n = candidates.size(); k < n; ++k)
+    {
+        if(attributes[candidates[k]]->name == it->first)
+        {
+            if(selected) *selected = splits[k];
+
+            return(candidates[k]);
+        }
+    }
+
+    return(-1);
+}
+
+AttributeSelection::Split AttributeSelection::Evaluate(DataFrameView &subsamples, Attribute *attribute,
+    const std::vector <uint> &classCodes, uint classes)
+/*------------------------------------------------------------------------------
+desc | . scores an attribute by every criterion from one contingency table.
+------------------------------------------------------------------------------*/
+{
+    std::vector <uint> valueCodes;
+
+    std::unique_ptr<std::vector<ML::Attribute::ProbabilityDistribution>> probabilityDistribution(
+        attribute->GetProbabilityDistribution(subsamples, {}, &valueCodes));
 
-    float entropy = subsamples.attributes.back()->GetAttributeEntropy();
+    ContingencyTable table(valueCodes, probabilityDistribution->size(), classCodes, classes);
 
-    for(uint i = 0, n = subsamples.attributes.size() - classes; i < n; ++i)
+    std::vector <float> p;
+
+    float N = subsamples.Size();
+
+    for(uint j = 0, m = (*probabilityDistribution).size(); j < m; ++j)
+        p.push_back((*probabilityDistribution)[j].p / N);
+
+    return(Score(table, p));
+}
+
+AttributeSelection::Split AttributeSelection::Evaluate(const Histogram &histogram, uint column, float N,
+    const ubyte criterion)
+/*------------------------------------------------------------------------------
+desc | . best split of a binned attribute over every bin boundary of the node.
+nots | . one pass over the bins, the rows below a boundary are a prefix sum.
+     | . proportions are taken as the distribution of the split would give them,
+     |   so scores compare with those of unbinned attributes.
+     | . boundary is left -1 if every row of the node falls in the same bin.
+------------------------------------------------------------------------------*/
+{
+    Split best;
+
+    const std::vector <int> &counts = histogram.counts[column];
+
+    uint K = histogram.binning->classes;
+    uint B = counts.size() / K;
+
+    ContingencyTable table(2, K, N);
+
+    for(uint b = 0; b < B; ++b)
     {
-        auto it = std::find(subattributes.begin(), subattributes.end(), subsamples.attributes[i]->name);
+        for(uint classe = 0; classe < K; ++classe)
+            table.classCounts[classe] += counts[b * K + classe];
+    }
+
+    std::vector <float> p(2);
 
-        if(it != subattributes.end())
+    for(uint b = 0; b + 1 < B; ++b)
+    {
+        for(uint classe = 0; classe < K; ++classe)
         {
-            std::vector<ML::Attribute::ProbabilityDistribution> *probabilityDistribution = subsamples.attributes[i]->GetProbabilityDistribution();
+            table.counts[classe] += counts[b * K + classe];
+            table.valueCounts[0] += counts[b * K + classe];
+        }
 
-            float gain = 0.0f;
-            float N = subsamples.attributes[i]->Size();
+        if(!table.valueCounts[0]) continue;
 
-            for(uint j = 0, m = (*probabilityDistribution).size(); j < m; ++j)
-            {
-                gain -= (((*probabilityDistribution)[j].p / N) * subsamples.attributes.back()->GetAttributeEntropy((*probabilityDistribution)[j].indexes));
-            }
+        table.valueCounts[1] = (int)(N) - table.valueCounts[0];
+
+        if(!table.valueCounts[1]) break;
+
+        for(uint classe = 0; classe < K; ++classe)
+            table.counts[K + classe] = table.classCounts[classe] - table.counts[classe];
+
+        p[0] = ((float)(table.valueCounts[0]) / N) / N;
+        p[1] = ((float)(table.valueCounts[1]) / N) / N;
 
-            informationGain.insert(std::pair<std::wstring, float>(subsamples.attributes[i]->name, entropy + gain));
+        Split split = Score(table, p);
 
-            delete(probabilityDistribution);
+        if((best.boundary == (uint)-1) || split.IsBetter(best, criterion))
+        {
+            best = split;
+            best.boundary = b;
         }
     }
 
-    auto it = informationGain.begin();
-    int maximum = ML::FrecuencyMax<std::wstring, float>(informationGain);
-    std::advance(it, maximum);
+    return(best);
+}
+
+AttributeSelection::Split AttributeSelection::Score(const ContingencyTable &table, const std::vector <float> &p)
+/*------------------------------------------------------------------------------
+vars | p : weight of every value of the table
+------------------------------------------------------------------------------*/
+{
+    Split split;
+
+    float entropy = table.GetEntropy();
 
-    return(it->first);
+    float gain = 0.0f;
+    float postGini = 0.0f;
+    float division = 0.0f;
+
+    for(uint j = 0, m = p.size(); j < m; ++j)
+    {
+        gain -= (p[j] * table.GetEntropy(j));
+        postGini += (p[j] * table.GetGiniIndex(j));
+        division -= (p[j] * log2(p[j]));
+    }
+
+    split.informationGain = entropy + gain;
+    split.giniImpurity = postGini;
+    split.proportionGain = (entropy + gain) / division;
+
+    return(split);
 }
 
-std::wstring AttributeSelection::GiniImpurity(DataFrame &subsamples,
-    std::vector<std::wstring> &subattributes, const ubyte classes)
+//------------------------------------------------------------------------| CompiledTree
+
+CompiledTree::Value CompiledTree::Accessor::GetValue(uint row) const
+{
+    Value value;
+
+    switch(type)
+    {
+    case Variant::Bool : value.i = (bools[row >> 6] >> (row & 63)) & 1; break;
+    case Variant::Int : value.i = ints[row]; break;
+    case Variant::Float : value.f = floats[row]; break;
+    case Variant::WString :
+        value.i = ranks.empty() ? GetRank(*strings, dictionary->GetValue(codes[row])) : ranks[codes[row]];
+        break;
+    default : value.i = 0;
+    }
+
+    return(value);
+}
+
+int CompiledTree::GetRank(const std::vector <std::wstring> &strings, const std::wstring &value)
+{
+    auto it = std::lower_bound(strings.begin(), strings.end(), value);
+
+    return(2 * (it - strings.begin()) - (((it == strings.end()) || (*it != value)) ? 1 : 0));
+}
+
+bool CompiledTree::IsEmpty(void) const {return(nodeColumns.empty());}
+
+void CompiledTree::Clear(void)
+{
+    nodeColumns.clear();
+    nodeEdges.clear();
+
+    edgeMathops.clear();
+    edgeValues.clear();
+    edgeTargets.clear();
+
+    sources.clear();
+    columns.clear();
+
+    accessors.clear();
+}
+
+bool CompiledTree::Compile(const std::vector <Node *> &nodes, const std::map <Node *, Hierarchy> &hierarchy)
 /*------------------------------------------------------------------------------
-nots | . source : https://www.researchgate.net/post/How_to_compute_impurity_using_Gini_Index
+desc | . lays out the nodes reachable from nodes[0] in depth first order.
+nots | . fails, leaving the form empty, if the edges of a column are not all of
+     |   the same bool, int, float or string type.
 ------------------------------------------------------------------------------*/
 {
-    std::map <std::wstring, float> giniIndex;
+    Clear();
 
-//    float prevGini = subsamples.attributes.back()->GetAttributeEntropy();
+    if(nodes.empty()) return(false);
 
-    for(uint i = 0, n = subsamples.attributes.size() - classes; i < n; ++i)
+    // '--> Number nodes in depth first order.
+
+    std::map <Node *, uint> indexes;
+    std::vector <Node *> stack(1, nodes[0]);
+
+    while(!stack.empty())
     {
-        auto it = std::find(subattributes.begin(), subattributes.end(), subsamples.attributes[i]->name);
+        Node *node = stack.back();
+
+        stack.pop_back();
+
+        indexes[node] = sources.size();
+        sources.push_back(node);
+
+        auto it = hierarchy.find(node);
+
+        if(node->leaf || (it == hierarchy.end())) continue;
 
-        if(it != subattributes.end())
+        for(uint i = it->second.edges.size(); i > 0; --i)
+            stack.push_back(it->second.edges[i - 1]->target);
+    }
+
+    // '--> Lay out columns and edges.
+
+    std::map <std::wstring, uint> names;
+
+    for(Node *node : sources)
+    {
+        nodeEdges.push_back(edgeTargets.size());
+
+        auto it = hierarchy.find(node);
+
+        if(node->leaf)
         {
-            std::vector<ML::Attribute::ProbabilityDistribution> *probabilityDistribution = subsamples.attributes[i]->GetProbabilityDistribution();
+            nodeColumns.push_back(-1);
+            continue;
+        }
+
+        std::wstring name = node->data.ToWString();
+
+        auto itName = names.find(name);
 
-            float postGini = 0.0f;
-            float N = subsamples.attributes[i]->Size();
+        if(itName == names.end())
+        {
+            itName = names.insert(std::pair<std::wstring, uint>(name, columns.size())).first;
+
+            columns.push_back(Column());
+            columns.back().name = name;
+            columns.back().id = node->column;
+            columns.back().type = Variant::Generic;
+        }
 
-            for(uint j = 0, m = (*probabilityDistribution).size(); j < m; ++j)
+        Column &column = columns[itName->second];
+
+        nodeColumns.push_back(itName->second);
+
+        if(it == hierarchy.end()) continue;
+
+        for(Edge *edge : it->second.edges)
+        {
+            if(column.type == Variant::Generic) column.type = edge->data.type;
+
+            Value value;
+
+            value.i = 0;
+
+            switch((edge->data.type == column.type) ? column.type : Variant::Generic)
             {
-                postGini += (((*probabilityDistribution)[j].p / N) * subsamples.attributes.back()->GetAttributeGiniIndex((*probabilityDistribution)[j].indexes));
+            case Variant::Bool : value.i = edge->data.data.b ? 1 : 0; break;
+            case Variant::Int : value.i = edge->data.data.i; break;
+            case Variant::Float : value.f = edge->data.data.f; break;
+            case Variant::WString : column.strings.push_back(edge->data.ToWString()); break;
+            default :
+                Clear();
+                return(false);
             }
 
-            giniIndex.insert(std::pair<std::wstring, float>(subsamples.attributes[i]->name, postGini));
-
-            delete(probabilityDistribution);
+            edgeMathops.push_back(edge->mathop);
+            edgeValues.push_back(value);
+            edgeTargets.push_back(indexes[edge->target]);
         }
     }
 
-    auto it = giniIndex.begin();
-    int maximum = ML::FrecuencyMin<std::wstring, float>(giniIndex);
-    std::advance(it, maximum);
+    nodeEdges.push_back(edgeTargets.size());
+
+    // '--> Rank strings.
+
+    for(Column &column : columns)
+    {
+        std::sort(column.strings.begin(), column.strings.end());
+        column.strings.erase(std::unique(column.strings.begin(), column.strings.end()), column.strings.end());
+    }
+
+    for(uint i = 0, n = sources.size(); i < n; ++i)
+    {
+        if((nodeColumns[i] < 0) || (columns[nodeColumns[i]].type != Variant::WString)) continue;
+
+        const std::vector <std::wstring> &values = columns[nodeColumns[i]].strings;
+
+        for(uint edge = nodeEdges[i], last = nodeEdges[i + 1]; edge < last; ++edge)
+        {
+            std::wstring value = hierarchy.find(sources[i])->second.edges[edge - nodeEdges[i]]->data.ToWString();
+
+            edgeValues[edge].i = 2 * (std::lower_bound(values.begin(), values.end(), value) - values.begin());
+        }
+    }
 
-    return(it->first);
+    return(true);
 }
 
-std::wstring AttributeSelection::ProportionGain(DataFrame &subsamples, std::vector<std::wstring> &subattributes,
-    const ubyte classes)
+bool CompiledTree::Bind(DataFrame &sample, std::vector <Accessor> &accessors, bool ranked) const
+/*------------------------------------------------------------------------------
+vars | accessors : reused when they were bound to this form, their columns are
+     |   tried before the names are looked up
+     | ranked : ranks every code of the dictionaries, worth it for many rows
+nots | . fails if a column is missing or its type differs from the tree.
+------------------------------------------------------------------------------*/
 {
-    std::map <std::wstring, float> proportionGain;
+    if(IsEmpty()) return(false);
 
-    float entropy = subsamples.attributes.back()->GetAttributeEntropy();
+    if(accessors.size() != columns.size()) accessors.assign(columns.size(), Accessor());
 
-    for(uint i = 0, n = subsamples.attributes.size() - classes; i < n; ++i)
+    for(uint i = 0, n = columns.size(); i < n; ++i)
     {
-        auto it = std::find(subattributes.begin(), subattributes.end(), subsamples.attributes[i]->name);
+        Accessor &accessor = accessors[i];
+
+        accessor.type = columns[i].type;
+
+        if(accessor.type == Variant::Generic) continue;
+
+        uint index = accessor.column;
+
+        if((index >= sample.attributes.size()) || (sample.attributes[index]->name != columns[i].name))
+            index = sample.GetColumnByAttribute(columns[i].name, columns[i].id);
+
+        if(index >= sample.attributes.size()) return(false);
 
-        if(it != subattributes.end())
+        accessor.column = index;
+
+        Attribute *attribute = sample.attributes[index];
+
+        if(attribute->type != accessor.type) return(false);
+
+        switch(accessor.type)
+        {
+        case Variant::Bool :
         {
-            std::vector<ML::Attribute::ProbabilityDistribution> *probabilityDistribution = subsamples.attributes[i]->GetProbabilityDistribution();
+            BoolAttribute *boolAttribute = static_cast<BoolAttribute *>(attribute);
 
-            float gain = 0.0f;
-            float division = 0.0f;
-            float N = subsamples.attributes[i]->Size();
+            accessor.bools = boolAttribute->cells.Words();
+            break;
+        }
+        case Variant::Int :
+        {
+            IntAttribute *intAttribute = static_cast<IntAttribute *>(attribute);
 
-            for(uint j = 0, m = (*probabilityDistribution).size(); j < m; ++j)
-            {
-                float p = (*probabilityDistribution)[j].p / N;
+            accessor.ints = intAttribute->cells.data();
+            break;
+        }
+        case Variant::Float :
+        {
+            FloaAttribute *floatAttribute = static_cast<FloaAttribute *>(attribute);
 
-                gain -= (p * subsamples.attributes.back()->GetAttributeEntropy((*probabilityDistribution)[j].indexes));
-                division -= (p * log2(p));
-            }
+            accessor.floats = floatAttribute->cells.data();
+            break;
+        }
+        case Variant::WString :
+        {
+            WStringAttribute *wstringAttribute = static_cast<WStringAttribute *>(attribute);
+
+            accessor.codes = wstringAttribute->cells.data();
+            accessor.dictionary = &wstringAttribute->dictionary;
+            accessor.strings = &columns[i].strings;
 
-            proportionGain.insert(std::pair<std::wstring, float>(subsamples.attributes[i]->name, (entropy + gain) / division));
+            accessor.ranks.resize(ranked ? wstringAttribute->dictionary.Size() : 0);
 
-            delete(probabilityDistribution);
+            for(uint code = 0, m = accessor.ranks.size(); code < m; ++code)
+                accessor.ranks[code] = GetRank(columns[i].strings, wstringAttribute->dictionary.GetValue(code));
+            break;
+        }
+        default : break;
         }
     }
 
-    auto it = proportionGain.begin();
-    int maximum = ML::FrecuencyMax<std::wstring, float>(proportionGain);
-    std::advance(it, maximum);
+    return(true);
+}
+
+bool CompiledTree::Step(const std::vector <Accessor> &accessors, uint row, uint &node) const
+/*------------------------------------------------------------------------------
+desc | . moves node one level down for row.
+nots | . returns false at a leaf or when no edge matches, node is then final.
+------------------------------------------------------------------------------*/
+{
+    if(nodeColumns[node] < 0) return(false);
+
+    const Accessor &accessor = accessors[nodeColumns[node]];
+
+    Value value = accessor.GetValue(row);
+
+    uint edge = nodeEdges[node];
+    uint last = nodeEdges[node + 1];
+
+    if(accessor.type == Variant::Float)
+        for(; (edge < last) && !ValidateValue(value.f, edgeMathops[edge], edgeValues[edge].f); ++edge);
+    else
+        for(; (edge < last) && !ValidateValue(value.i, edgeMathops[edge], edgeValues[edge].i); ++edge);
+
+    if(edge == last) return(false);
+
+    node = edgeTargets[edge];
+
+    return(true);
+}
+
+Node *CompiledTree::Predict(DataFrame &sample)
+/*------------------------------------------------------------------------------
+desc | . final node of the first row of sample, nullptr if it does not bind.
+nots | . binding again a sample with the same columns allocates nothing and
+     |   looks nothing up, strings are ranked only at the nodes visited.
+------------------------------------------------------------------------------*/
+{
+    if(!Bind(sample, accessors, false)) return(nullptr);
+
+    return(Predict(accessors, 0));
+}
+
+Node *CompiledTree::Predict(const std::vector <Accessor> &accessors, uint row) const
+{
+    uint node = 0;
+
+    while(Step(accessors, row, node));
 
-    return(it->first);
+    return(sources[node]);
+}
+
+void CompiledTree::PredictBatch(const std::vector <Accessor> &accessors, const RowSet &rows, uint *leaves) const
+/*------------------------------------------------------------------------------
+desc | . final node of every row, in row order.
+nots | . rows are walked lanes at a time one level per round, so the loads of a
+     |   row overlap with the comparisons of the others.
+------------------------------------------------------------------------------*/
+{
+    const uint lanes = 8;
+
+    uint laneRows[lanes];
+    uint laneNodes[lanes];
+
+    uint m = 0;
+
+    auto flush = [&](void)
+    {
+        for(uint k = 0; k < m; ++k)
+            laneNodes[k] = 0;
+
+        for(bool active = true; active;)
+        {
+            active = false;
+
+            for(uint k = 0; k < m; ++k)
+                active |= Step(accessors, laneRows[k], laneNodes[k]);
+        }
+
+        for(uint k = 0; k < m; ++k)
+            *leaves++ = laneNodes[k];
+
+        m = 0;
+    };
+
+    for(uint row : rows)
+    {
+        laneRows[m++] = row;
+
+        if(m == lanes) flush();
+    }
+
+    flush();
 }
 
 //------------------------------------------------------------------------| Tree
 
-Tree::Tree(void) {}
+Tree::Tree(void) : pool(nullptr) {}
+
+Tree::~Tree(void)
+{
+    Clear();
+}
 
 Node *Tree::AddNode(void)
 {
-    Node *node = new Node();
+    Node *node = nodeArena.New();
 
     nodes.push_back(node);
 
@@ -152,7 +948,7 @@ Node *Tree::AddNode(void)
 
 Edge *Tree::AddEdge(const Variant &data, float p, MathOp mathop, Node *source, Node *target)
 {
-    Edge *edge = new Edge(data, p, mathop, source, target);
+    Edge *edge = edgeArena.New(data, p, mathop, source, target);
 
     edges.push_back(edge);
 
@@ -161,8 +957,31 @@ Edge *Tree::AddEdge(const Variant &data, float p, MathOp mathop, Node *source, N
 
 void Tree::Clear(void)
 {
-    clrptrvector<Node *>(nodes);
-    clrptrvector<Edge *>(edges);
+    nodes.clear();
+    edges.clear();
+    hierarchy.clear();
+
+    compiled.Clear();
+
+    nodeArena.Clear();
+    edgeArena.Clear();
+}
+
+void Tree::Append(Fragment &fragment)
+{
+    nodes.insert(nodes.end(), fragment.nodes.begin(), fragment.nodes.end());
+    edges.insert(edges.end(), fragment.edges.begin(), fragment.edges.end());
+
+    fragment.nodes.clear();
+    fragment.edges.clear();
+
+    nodeArena.Splice(fragment.nodeArena);
+    edgeArena.Splice(fragment.edgeArena);
+}
+
+void Tree::ClearColumn(uint column, std::vector <uint> &columns)
+{
+    columns.erase(std::remove(columns.begin(), columns.end(), column), columns.end());
 }
 
 void Tree::ClearAttribute(const std::wstring &attribute, std::vector <std::wstring> &attributes)
@@ -177,6 +996,7 @@ void Tree::ClearAttribute(const std::wstring &attribute, std::vector <std::wstri
 void Tree::RankHierarchy(void)
 {
     hierarchy.clear();
+    compiled.Clear();
 
     if(nodes.empty()) return;
 
@@ -187,10 +1007,19 @@ void Tree::RankHierarchy(void)
 
     for(uint i = 0, n = edges.size(); i < n; ++i)
         hierarchy.find(edges[i]->source)->second.edges.push_back(edges[i]);
+
+    Compile();
+}
+
+void Tree::Compile(void)
+{
+    compiled.Compile(nodes, hierarchy);
 }
 
 void Tree::Prune(Node *node)
 {
+    compiled.Clear();
+
     auto itActual = hierarchy.find(node);
 
     if(itActual->second.edges.size() == 1)
@@ -228,18 +1057,49 @@ void Tree::Prune(Node *node)
     }
 }
 
+bool Tree::PredictBatch(DataFrame &samples, uint *leaves)
+{
+    DataFrameView view(&samples);
+
+    return(PredictBatch(view, leaves));
+}
+
+bool Tree::PredictBatch(const DataFrameView &samples, uint *leaves)
+/*------------------------------------------------------------------------------
+vars | leaves : one entry per row of samples, receives compiled node ids
+nots | . compiled.sources maps ids back to nodes.
+     | . fails, writing nothing, if there is no compiled form or the samples do
+     |   not bind to it.
+------------------------------------------------------------------------------*/
+{
+    std::vector <CompiledTree::Accessor> accessors;
+
+    if(!compiled.Bind(*samples.dataframe, accessors)) return(false);
+
+    compiled.PredictBatch(accessors, samples.rows, leaves);
+
+    return(true);
+}
+
 Node *Tree::Predict(DataFrame &sample)
+/*------------------------------------------------------------------------------
+nots | . uses the compiled form when the sample binds to it.
+------------------------------------------------------------------------------*/
 {
     if(nodes.empty()) return(nullptr);
 
-    Node *node = nodes[0];
+    Node *node = compiled.Predict(sample);
+
+    if(node) return(node);
+
+    node = nodes[0];
 
     while(true)
     {
         if(node->leaf) break;
 
         std::wstring attribute = node->data.ToWString();
-        uint index = sample.GetColumnByAttribute(attribute);
+        uint index = sample.GetColumnByAttribute(attribute, node->column);
 
         Variant valueA = sample.attributes[index]->GetCell(0);
 
@@ -5,7 +5,11 @@ auth | Roberto Peribáñez Iglesias (ergocortex) 2018
 #ifndef TREE_H
 #define TREE_H
 
+#include <memory>
+
 #include "core.h"
+#include "pool.h"
+#include "arena.h"
 
 namespace ML
 {
@@ -14,6 +18,7 @@ namespace ML
 class Node
 /*------------------------------------------------------------------------------
 vars | leaf | false : data = attribute | true : data = value (class)
+     | column : id of the attribute in the trained dataframe | -1 : leaf
 ------------------------------------------------------------------------------*/
 {
 public :
@@ -22,6 +27,8 @@ public :
 
     bool leaf;
 
+    uint column;
+
 public :
 
     Node(void);
@@ -31,12 +38,17 @@ public :
 //------------------------------------------------------------------------| Edge
 
 class Edge
+/*------------------------------------------------------------------------------
+vars | column : id of the attribute of source, taken when the edge is created
+------------------------------------------------------------------------------*/
 {
 public :
 
     Node *source;
     Node *target;
 
+    uint column;
+
     Variant data;
 
     MathOp mathop;
@@ -63,25 +75,321 @@ public :
     Hierarchy(Node *parent) : parent(parent) {}
 };
 
+//------------------------------------------------------------------------| Fragment
+
+class Fragment
+/*------------------------------------------------------------------------------
+desc | . nodes and edges of a subtree built by one induction task.
+nots | . child fragments are appended in the order serial induction creates them.
+     | . nodes and edges live in the arenas of the fragment, which move with them.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    std::vector <Node *> nodes;
+    std::vector <Edge *> edges;
+
+    Arena <Node> nodeArena;
+    Arena <Edge> edgeArena;
+
+public :
+
+    Node *AddNode(void);
+    Edge *AddEdge(const Variant &data, float p, MathOp mathop = 0, Node *source = nullptr, Node *target = nullptr);
+
+    void Append(Fragment &fragment);
+};
+
+//------------------------------------------------------------------------| ContingencyTable
+
+class ContingencyTable
+/*------------------------------------------------------------------------------
+desc | . counts of the rows of a node by attribute value and class.
+nots | . built in a single pass, values and classes are codes in value order.
+     | . proportions are taken over the rows of the node, as attribute queries do.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    uint values;
+    uint classes;
+
+    float N;
+
+    std::vector <int> counts;
+    std::vector <int> valueCounts;
+    std::vector <int> classCounts;
+
+public :
+
+    ContingencyTable(const std::vector <uint> &valueCodes, uint values,
+        const std::vector <uint> &classCodes, uint classes);
+    ContingencyTable(uint values, uint classes, float N);
+
+    float GetEntropy(void) const;
+    float GetEntropy(uint value) const;
+
+    float GetGiniIndex(void) const;
+    float GetGiniIndex(uint value) const;
+
+private :
+
+    float GetEntropy(const int *frecuency) const;
+    float GetGiniIndex(const int *frecuency) const;
+};
+
+//------------------------------------------------------------------------| Binning
+
+class Binning
+/*------------------------------------------------------------------------------
+desc | . continuous attributes of the training rows of a dataframe quantized
+     |   once into at most maxBins bins, for histogram split search.
+vars | thresholds : by column, lower bound of every bin but the first, empty
+     |   if the column is not binned
+     | codes : by column, bin of every row of the dataframe, 0 out of the view
+     | classCodes : class of every row of the dataframe, codes in value order
+nots | . bin bounds are quantiles of the column, so bins hold similar counts.
+     | . the last column is the class and is never binned.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    static const uint maxBins = 256;
+
+public :
+
+    std::vector <std::vector <Variant>> thresholds;
+    std::vector <std::vector <ubyte>> codes;
+
+    std::vector <uint> classCodes;
+    uint classes;
+
+public :
+
+    Binning(void);
+
+    void Build(const DataFrameView &view, uint bins);
+    void Clear(void);
+
+    bool IsBuilt(void) const;
+    bool IsBinned(uint column) const;
+
+    std::vector<Attribute::ProbabilityDistribution> *GetProbabilityDistribution(
+        const DataFrameView &view, uint column, uint boundary) const;
+};
+
+//------------------------------------------------------------------------| Histogram
+
+class Histogram
+/*------------------------------------------------------------------------------
+desc | . class counts by bin of the binned attributes over the rows of a node.
+vars | counts : by column, bins * classes counts, empty if not binned or not
+     |   a candidate of the node
+nots | . the children of a node are divided from it : every child but the
+     |   largest is counted from its rows, the largest is the node minus them.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    const Binning *binning;
+
+    std::vector <std::vector <int>> counts;
+
+public :
+
+    Histogram(const Binning *binning = nullptr);
+
+    void Accumulate(const DataFrameView &view, const std::vector <uint> &columns);
+
+    std::vector <Histogram> Divide(const std::vector <DataFrameView> &subviews,
+        const std::vector <uint> &columns) const;
+
+    bool IsCounted(uint column) const;
+};
+
 //------------------------------------------------------------------------| AttributeSelection
 
 class AttributeSelection
+/*------------------------------------------------------------------------------
+vars | criterion | 0 : Information Gain | 1 : Gini Impurity | 2 : Proportion Gain
+     | pool : if given, candidate attributes are scored concurrently
+     | histogram : if given, binned attributes are split at their best bin boundary
+     | selected : if given, receives the split of the selected attribute
+------------------------------------------------------------------------------*/
 {
+public :
+
+    struct Split
+    /*--------------------------------------------------------------------------
+    vars | boundary : threshold of a binned split | -1 : split by the distribution
+         |   of the attribute
+    --------------------------------------------------------------------------*/
+    {
+    public :
+
+        float informationGain;
+        float giniImpurity;
+        float proportionGain;
+
+        uint boundary;
+
+    public :
+
+        Split(void) : informationGain(0.0f), giniImpurity(0.0f), proportionGain(0.0f), boundary(-1) {}
+
+        float GetScore(const ubyte criterion) const;
+        bool IsBetter(const Split &rhs, const ubyte criterion) const;
+    };
+
 public :
 
     static std::wstring InformationGain(DataFrame &subsamples, std::vector<std::wstring> &subattributes,
         const ubyte classes = 1);
+    static std::wstring InformationGain(DataFrameView &subsamples, std::vector<std::wstring> &subattributes,
+        const ubyte classes = 1, ThreadPool *pool = nullptr);
 
     static std::wstring GiniImpurity(DataFrame &subsamples, std::vector<std::wstring> &subattributes,
         const ubyte classes = 1);
+    static std::wstring GiniImpurity(DataFrameView &subsamples, std::vector<std::wstring> &subattributes,
+        const ubyte classes = 1, ThreadPool *pool = nullptr);
 
     static std::wstring ProportionGain(DataFrame &subsamples, std::vector<std::wstring> &subattributes,
         const ubyte classes = 1);
+    static std::wstring ProportionGain(DataFrameView &subsamples, std::vector<std::wstring> &subattributes,
+        const ubyte classes = 1, ThreadPool *pool = nullptr);
+
+    static std::wstring Select(DataFrameView &subsamples, std::vector<std::wstring> &subattributes,
+        const ubyte criterion, const ubyte classes = 1, ThreadPool *pool = nullptr);
+    static uint SelectColumn(DataFrameView &subsamples, const std::vector <uint> &subcolumns,
+        const ubyte criterion, const ubyte classes = 1, ThreadPool *pool = nullptr,
+        const Histogram *histogram = nullptr, Split *selected = nullptr);
+
+    static Split Evaluate(DataFrameView &subsamples, Attribute *attribute,
+        const std::vector <uint> &classCodes, uint classes);
+    static Split Evaluate(const Histogram &histogram, uint column, float N, const ubyte criterion);
+
+    static Split Score(const ContingencyTable &table, const std::vector <float> &p);
+};
+
+//------------------------------------------------------------------------| CompiledTree
+
+class CompiledTree
+/*------------------------------------------------------------------------------
+desc | . flat form of a trained tree, nodes and edges are indexes into arrays.
+vars | nodeColumns : column of the node | -1 : leaf
+     | nodeEdges : edges of node i are [nodeEdges[i], nodeEdges[i + 1])
+     | edgeTargets : node reached through the edge
+     | sources : node of the tree every compiled node comes from
+     | accessors : binding of the last sample of Predict, reused while the
+     |   sample keeps its columns, cleared with the form
+nots | . the root is node 0, edges keep the order of the hierarchy.
+     | . strings are compared by rank in the sorted strings of their column, a
+     |   string not in the tree gets an odd rank between its neighbours.
+     | . Predict (sample) is not thread safe, concurrent callers Bind accessors
+     |   of their own once and reuse them across rows.
+------------------------------------------------------------------------------*/
+{
+public :
+
+    union Value
+    {
+        int i;
+        float f;
+    };
+
+    struct Column
+    {
+    public :
+
+        std::wstring name;
+
+        uint id;
+
+        Variant::Type type;
+
+        std::vector <std::wstring> strings;
+    };
+
+    struct Accessor
+    /*--------------------------------------------------------------------------
+    desc | . cells of a sample column bound to a compiled column.
+    vars | column : column of the sample, tried first when binding again
+         | bools : words of a bit packed bool column
+         | ranks : rank of every code of the dictionary, when empty the rank
+         |   is searched at every access
+    --------------------------------------------------------------------------*/
+    {
+    public :
+
+        Variant::Type type;
+
+        uint column;
+
+        const uint64_t *bools;
+        const int *ints;
+        const float *floats;
+        const uint *codes;
+
+        const Dictionary *dictionary;
+        const std::vector <std::wstring> *strings;
+
+        std::vector <int> ranks;
+
+    public :
+
+        Value GetValue(uint row) const;
+    };
+
+public :
+
+    std::vector <int> nodeColumns;
+    std::vector <uint> nodeEdges;
+
+    std::vector <MathOp> edgeMathops;
+    std::vector <Value> edgeValues;
+    std::vector <uint> edgeTargets;
+
+    std::vector <Node *> sources;
+
+    std::vector <Column> columns;
+
+    std::vector <Accessor> accessors;
+
+public :
+
+    static int GetRank(const std::vector <std::wstring> &strings, const std::wstring &value);
+
+public :
+
+    bool IsEmpty(void) const;
+
+    void Clear(void);
+
+    bool Compile(const std::vector <Node *> &nodes, const std::map <Node *, Hierarchy> &hierarchy);
+
+    bool Bind(DataFrame &sample, std::vector <Accessor> &accessors, bool ranked = true) const;
+
+    Node *Predict(DataFrame &sample);
+    Node *Predict(const std::vector <Accessor> &accessors, uint row) const;
+    void PredictBatch(const std::vector <Accessor> &accessors, const RowSet &rows, uint *leaves) const;
+
+private :
+
+    bool Step(const std::vector <Accessor> &accessors, uint row, uint &node) const;
 };
 
 //------------------------------------------------------------------------| Tree
 
 class Tree
+/*------------------------------------------------------------------------------
+vars | pool : optional, used to parallelize training
+     | compiled : flat form used by Predict, rebuilt by RankHierarchy
+     | nodeArena, edgeArena : own every node and edge, freed at once by Clear
+nots | . after editing nodes, edges or hierarchy call Compile, Predict walks the
+     |   hierarchy until then.
+     | . nodes and edges are never deleted one by one, pruned ones stay in the
+     |   arenas until Clear.
+------------------------------------------------------------------------------*/
 {
 public :
 
@@ -102,28 +410,44 @@ public :
 
     DataFrame samples;
 
+    ThreadPool *pool;
+
     std::vector <Node *> nodes;
     std::vector <Edge *> edges;
 
+    Arena <Node> nodeArena;
+    Arena <Edge> edgeArena;
+
     std::map<Node *, Hierarchy> hierarchy;
 
+    CompiledTree compiled;
+
 public :
 
     Tree(void);
+    virtual ~Tree(void);
 
     Node *AddNode(void);
     Edge *AddEdge(const Variant &data, float p, MathOp mathop = 0, Node *source = nullptr, Node *target = nullptr);
 
     void Clear(void);
 
+    void Append(Fragment &fragment);
+
     void ClearAttribute(const std::wstring &attribute, std::vector <std::wstring> &attributes);
+    void ClearColumn(uint column, std::vector <uint> &columns);
 
     void RankHierarchy(void);
 
+    void Compile(void);
+
     void Prune(Node *node);
 
     Node *Predict(DataFrame &sample);
 
+    bool PredictBatch(DataFrame &samples, uint *leaves);
+    bool PredictBatch(const DataFrameView &samples, uint *leaves);
+
     void GetProbabilityClusters(Node *node, std::vector <ProbabilityCluster> &probabilityCluster, float p = 1.0f);
 };
 }